@@ -0,0 +1,68 @@
+#include "arena.h"
+
+/**
+ * @brief Round a size up to the alignment of the arena
+ *
+ * @param size The size
+ * @return The aligned size
+ */
+static size_t arena_align(size_t size) {
+  return (size + ARENA_ALIGNMENT - 1) & ~(size_t)(ARENA_ALIGNMENT - 1);
+}
+
+void init_arena(arena *arena, buffer_pool *pool) {
+  arena->pool = pool;
+  arena->blocks = NULL;
+  arena->last = NULL;
+}
+
+void *arena_alloc(arena *arena, size_t size) {
+  buffer_t *block = arena->blocks;
+  size_t offset = block == NULL ? 0 : arena_align(block->length);
+
+  if (block == NULL || offset + size > block->capacity) {
+    // the rest of the current block is given up
+    block = acquire_buffer(arena->pool, size > ARENA_BLOCK_SIZE ? size : ARENA_BLOCK_SIZE);
+
+    if (block == NULL) {
+      return NULL;
+    }
+
+    block->next = arena->blocks;
+    arena->blocks = block;
+    offset = 0;
+  }
+
+  block->length = offset + size;
+  arena->last = block->data + offset;
+
+  return arena->last;
+}
+
+bool arena_extend(arena *arena, void *ptr, size_t size) {
+  buffer_t *block = arena->blocks;
+
+  if (ptr == NULL || ptr != arena->last) {
+    return false;
+  }
+
+  size_t offset = arena->last - block->data;
+
+  if (offset + size > block->capacity) {
+    return false;
+  }
+
+  block->length = offset + size;
+
+  return true;
+}
+
+void release_arena(arena *arena) {
+  while (arena->blocks != NULL) {
+    buffer_t *block = arena->blocks;
+    arena->blocks = block->next;
+    release_buffer(arena->pool, &block);
+  }
+
+  arena->last = NULL;
+}
@@ -0,0 +1,76 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include "../buffer_pool/buffer_pool.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * Size of a regular arena block (one pooled buffer), larger allocations get a block of their own.
+ */
+#define ARENA_BLOCK_SIZE BUFFER_POOL_MIN_SIZE
+
+/**
+ * Alignment of every allocation of an arena.
+ */
+#define ARENA_ALIGNMENT 16
+
+/**
+ * Bump allocator for memory that is released all at once (e.g. everything that belongs to the
+ * responses of a connection). The memory is taken from pooled buffers, the current block is the
+ * first one of the list and its length is the number of bytes that are in use.
+ * @warning An arena is not thread-safe, it has to be used with the pool of the calling thread
+ */
+struct arena {
+  buffer_pool *pool;
+  buffer_t *blocks;
+  // start of the last allocation (the only one that can be extended)
+  char *last;
+} typedef arena;
+
+/**
+ * @brief Initialize an empty arena
+ *
+ * No memory is taken from the pool until the first allocation.
+ *
+ * @param arena The arena
+ * @param pool The buffer pool the blocks are taken from
+ */
+void init_arena(arena *arena, buffer_pool *pool);
+
+/**
+ * @brief Allocate memory from an arena
+ * @warning The memory is not initialized and must not be freed, it is released with release_arena()
+ *
+ * Returns NULL if memory allocation fails.
+ *
+ * @param arena The arena
+ * @param size The number of bytes
+ * @return The allocated memory (aligned to ARENA_ALIGNMENT)
+ */
+void *arena_alloc(arena *arena, size_t size);
+
+/**
+ * @brief Grow the last allocation of an arena in place
+ *
+ * Returns false if ptr is not the last allocation or the current block has no room left, the
+ * allocation is unchanged in this case.
+ *
+ * @param arena The arena
+ * @param ptr The allocation to grow
+ * @param size The new size of the allocation
+ * @return true if the allocation has been grown
+ */
+bool arena_extend(arena *arena, void *ptr, size_t size);
+
+/**
+ * @brief Release all memory of an arena at once
+ *
+ * The blocks are returned to the pool, so the next allocations reuse them. The arena stays
+ * initialized and can be used again.
+ *
+ * @param arena The arena
+ */
+void release_arena(arena *arena);
+
+#endif
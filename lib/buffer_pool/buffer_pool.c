@@ -0,0 +1,149 @@
+#include "buffer_pool.h"
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * @brief Get the size class of a capacity
+ *
+ * @param capacity The capacity
+ * @return The index of the smallest class that fits the capacity, BUFFER_POOL_CLASSES if no pooled
+ * buffer is large enough
+ */
+static size_t buffer_class(size_t capacity) {
+  size_t index = 0;
+
+  while (index < BUFFER_POOL_CLASSES && ((size_t)BUFFER_POOL_MIN_SIZE << index) < capacity) {
+    index++;
+  }
+
+  return index;
+}
+
+buffer_pool *new_buffer_pool() { return calloc(1, sizeof(struct buffer_pool)); }
+
+void free_buffer_pool(buffer_pool **pool) {
+  if (*pool == NULL) {
+    return;
+  }
+
+  for (size_t i = 0; i < BUFFER_POOL_CLASSES; i++) {
+    while ((*pool)->free_buffers[i] != NULL) {
+      buffer_t *buffer = (*pool)->free_buffers[i];
+      (*pool)->free_buffers[i] = buffer->next;
+      free(buffer);
+    }
+  }
+
+  free(*pool);
+  *pool = NULL;
+}
+
+buffer_t *acquire_buffer(buffer_pool *pool, size_t capacity) {
+  size_t index = buffer_class(capacity);
+  buffer_t *buffer = NULL;
+
+  if (index < BUFFER_POOL_CLASSES && pool->free_buffers[index] != NULL) {
+    buffer = pool->free_buffers[index];
+    pool->free_buffers[index] = buffer->next;
+    pool->free_count[index]--;
+  } else {
+    // larger buffers are not pooled and get exactly the requested capacity
+    if (index < BUFFER_POOL_CLASSES) {
+      capacity = (size_t)BUFFER_POOL_MIN_SIZE << index;
+    }
+
+    buffer = malloc(sizeof(struct buffer_t) + capacity + 1);
+
+    if (buffer == NULL) {
+      return NULL;
+    }
+
+    buffer->capacity = capacity;
+    buffer->data = (char *)(buffer + 1);
+  }
+
+  buffer->length = 0;
+  buffer->next = NULL;
+
+  return buffer;
+}
+
+void release_buffer(buffer_pool *pool, buffer_t **buffer) {
+  if (*buffer == NULL) {
+    return;
+  }
+
+  size_t index = buffer_class((*buffer)->capacity);
+
+  if (index < BUFFER_POOL_CLASSES && pool->free_count[index] < BUFFER_POOL_MAX_FREE &&
+      (*buffer)->capacity == (size_t)BUFFER_POOL_MIN_SIZE << index) {
+    (*buffer)->next = pool->free_buffers[index];
+    pool->free_buffers[index] = *buffer;
+    pool->free_count[index]++;
+  } else {
+    free(*buffer);
+  }
+
+  *buffer = NULL;
+}
+
+bool grow_buffer(buffer_pool *pool, buffer_t **buffer, size_t capacity) {
+  if (*buffer != NULL && (*buffer)->capacity >= capacity) {
+    return true;
+  }
+
+  buffer_t *grown = acquire_buffer(pool, capacity);
+
+  if (grown == NULL) {
+    return false;
+  }
+
+  if (*buffer != NULL) {
+    memcpy(grown->data, (*buffer)->data, (*buffer)->length);
+    grown->length = (*buffer)->length;
+    release_buffer(pool, buffer);
+  }
+
+  *buffer = grown;
+
+  return true;
+}
+
+bool buffer_append(buffer_pool *pool, buffer_t **buffer, const char *data, size_t length) {
+  size_t used = *buffer == NULL ? 0 : (*buffer)->length;
+  size_t capacity = used + length;
+
+  // grow geometrically, so appending in small steps stays linear
+  if (*buffer != NULL && capacity > (*buffer)->capacity && capacity < (*buffer)->capacity * 2) {
+    capacity = (*buffer)->capacity * 2;
+  }
+
+  if (!grow_buffer(pool, buffer, capacity)) {
+    return false;
+  }
+
+  memcpy((*buffer)->data + used, data, length);
+  (*buffer)->length += length;
+
+  return true;
+}
+
+void buffer_consume(buffer_t *buffer, size_t length) {
+  if (length >= buffer->length) {
+    buffer->length = 0;
+    return;
+  }
+
+  memmove(buffer->data, buffer->data + length, buffer->length - length);
+  buffer->length -= length;
+}
+
+string buffer_string(buffer_t *buffer) {
+  if (buffer == NULL) {
+    return (string){.len = 0, .str = ""};
+  }
+
+  buffer->data[buffer->length] = '\0';
+
+  return (string){.len = buffer->length, .str = buffer->data};
+}
@@ -0,0 +1,135 @@
+#ifndef BUFFER_POOL_H
+#define BUFFER_POOL_H
+
+#include "../string_lib/string_lib.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * Capacity of the smallest pooled buffer (must be a power of 2).
+ */
+#define BUFFER_POOL_MIN_SIZE 4096
+
+/**
+ * Number of pooled buffer sizes, every size is twice the previous one (4 KiB, 8 KiB, 16 KiB).
+ * Larger buffers are allocated and freed directly.
+ */
+#define BUFFER_POOL_CLASSES 3
+
+/**
+ * Maximum number of free buffers kept per size, additional buffers are freed.
+ */
+#define BUFFER_POOL_MAX_FREE 256
+
+/**
+ * Buffer with its data stored directly behind the header (one allocation).
+ * The data has room for capacity bytes and a null terminator.
+ */
+struct buffer_t {
+  size_t length;
+  size_t capacity;
+  struct buffer_t *next;
+  char *data;
+} typedef buffer_t;
+
+/**
+ * Freelists of released buffers, one per size.
+ * @warning A pool is not thread-safe, every thread has to use its own pool
+ */
+struct buffer_pool {
+  buffer_t *free_buffers[BUFFER_POOL_CLASSES];
+  size_t free_count[BUFFER_POOL_CLASSES];
+} typedef buffer_pool;
+
+/**
+ * @brief Create a new buffer pool
+ *
+ * Returns NULL if memory allocation fails.
+ *
+ * @return The created buffer pool
+ */
+buffer_pool *new_buffer_pool();
+
+/**
+ * @brief Free a buffer pool and all of its free buffers
+ * @warning Buffers that are still in use have to be released before
+ *
+ * Returns if the buffer pool is NULL.
+ *
+ * @param pool Buffer pool to be freed
+ */
+void free_buffer_pool(buffer_pool **pool);
+
+/**
+ * @brief Get an empty buffer with at least the given capacity
+ * @warning The content of the buffer is not initialized
+ *
+ * Reuses a released buffer of the pool if possible. Returns NULL if memory allocation fails.
+ *
+ * @param pool The buffer pool
+ * @param capacity The minimum capacity
+ * @return The buffer
+ */
+buffer_t *acquire_buffer(buffer_pool *pool, size_t capacity);
+
+/**
+ * @brief Return a buffer to the pool
+ *
+ * Returns if the buffer is NULL. The buffer pointer is set to NULL.
+ *
+ * @param pool The buffer pool
+ * @param buffer The buffer to be released
+ */
+void release_buffer(buffer_pool *pool, buffer_t **buffer);
+
+/**
+ * @brief Grow a buffer to at least the given capacity
+ *
+ * The content is moved into a larger buffer of the pool and the old buffer is released.
+ * Returns false (and keeps the buffer) if memory allocation fails.
+ *
+ * @param pool The buffer pool
+ * @param buffer The buffer to grow
+ * @param capacity The minimum capacity
+ * @return true if the buffer has at least the given capacity
+ */
+bool grow_buffer(buffer_pool *pool, buffer_t **buffer, size_t capacity);
+
+/**
+ * @brief Append data to a buffer
+ *
+ * Acquires the buffer if it is NULL and grows it if the data does not fit.
+ * Returns false if memory allocation fails.
+ *
+ * @param pool The buffer pool
+ * @param buffer The buffer to append to
+ * @param data The data to append
+ * @param length The length of the data
+ * @return true if the data has been appended
+ */
+bool buffer_append(buffer_pool *pool, buffer_t **buffer, const char *data, size_t length);
+
+/**
+ * @brief Remove data from the start of a buffer
+ *
+ * The remaining data is moved to the start of the buffer.
+ *
+ * @param buffer The buffer
+ * @param length The number of bytes to remove
+ */
+void buffer_consume(buffer_t *buffer, size_t length);
+
+/**
+ * @brief Get the content of a buffer as a string
+ * @warning The string points into the buffer, it must not be freed and is only valid until the
+ * buffer is changed
+ *
+ * The content is null terminated, so the string can be used with all string_lib functions.
+ * Returns an empty string if the buffer is NULL.
+ *
+ * @param buffer The buffer
+ * @return The content of the buffer (not copied)
+ */
+string buffer_string(buffer_t *buffer);
+
+#endif
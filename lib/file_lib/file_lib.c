@@ -1,7 +1,13 @@
 #include "file_lib.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/openat2.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
 
 string *read_file(string *path) {
   if (path == NULL) {
@@ -32,12 +38,7 @@ string *read_file(string *path) {
   fseek(file, 0, SEEK_SET);
 
   string *content = _new_string();
-  free(content->str);
-  content->str = calloc(length + 1, 1);
-
-  if (content->str == NULL) {
-    return NULL;
-  }
+  str_reserve(content, length);
 
   // read file content
   fread(get_char_str(content), 1, length, file);
@@ -46,4 +47,486 @@ string *read_file(string *path) {
   fclose(file);
 
   return content;
-}
\ No newline at end of file
+}
+
+/**
+ * @brief Check that an opened file is a regular file and get its size
+ *
+ * The file descriptor is closed if it is not a regular file.
+ *
+ * @param fd The opened file
+ * @param size Set to the size of the file
+ * @return The file descriptor, -1 if it is not a regular file (errno is set to ENOENT)
+ */
+static int opened_regular_file(int fd, size_t *size) {
+  if (fd < 0) {
+    return -1;
+  }
+
+  struct stat s;
+
+  // directories and other special files are not served
+  if (fstat(fd, &s) != 0 || !S_ISREG(s.st_mode)) {
+    close(fd);
+    errno = ENOENT;
+    return -1;
+  }
+
+  *size = s.st_size;
+
+  return fd;
+}
+
+int open_file(string *path, size_t *size) {
+  if (path == NULL) {
+    errno = ENOENT;
+    return -1;
+  }
+
+  return opened_regular_file(open(get_char_str(path), O_RDONLY | O_CLOEXEC), size);
+}
+
+int open_file_beneath(int root_fd, const char *path, size_t *size) {
+  if (path == NULL) {
+    errno = ENOENT;
+    return -1;
+  }
+
+  // the kernel rejects paths that leave the root directory (with "..", absolute paths or symlinks)
+  // and does not follow the magic links of /proc
+  struct open_how how = {
+      .flags = O_RDONLY | O_CLOEXEC,
+      .resolve = RESOLVE_BENEATH | RESOLVE_NO_MAGICLINKS,
+  };
+
+  return opened_regular_file((int)syscall(SYS_openat2, root_fd, path, &how, sizeof(how)), size);
+}
+
+/**
+ * @brief Hash a path (FNV-1a)
+ *
+ * @param path The path
+ * @return The index of the bucket of the path
+ */
+static size_t file_cache_bucket(string *path) {
+  uint32_t hash = 2166136261u;
+
+  for (size_t i = 0; i < get_length(path); i++) {
+    hash ^= (unsigned char)path->str[i];
+    hash *= 16777619u;
+  }
+
+  return hash & (FILE_CACHE_BUCKETS - 1);
+}
+
+/**
+ * @brief Get the number of bytes of an entry that count against the memory budget
+ *
+ * @param entry The entry
+ * @return The size of the content and the header
+ */
+static size_t file_cache_entry_size(file_cache_entry *entry) {
+  return get_length(entry->content) + (entry->header == NULL ? 0 : get_length(entry->header));
+}
+
+/**
+ * @brief Free an entry
+ *
+ * @param entry The entry to be freed
+ */
+static void free_file_cache_entry(file_cache_entry *entry) {
+  if (entry->fd >= 0) {
+    close(entry->fd);
+  }
+
+  free_str(entry->path);
+  free_str(entry->content);
+  free_str(entry->header);
+  free(entry);
+}
+
+/**
+ * @brief Get the usage order an entry belongs to
+ *
+ * @param cache The file cache
+ * @param entry The entry
+ * @return The list of the cached contents, file descriptors or failed lookups
+ */
+static file_cache_list *file_cache_list_of(file_cache *cache, file_cache_entry *entry) {
+  if (entry->error != 0) {
+    return &cache->negatives;
+  }
+
+  return entry->fd < 0 ? &cache->contents : &cache->descriptors;
+}
+
+/**
+ * @brief Insert an entry at the head (most recently used end) of its usage order
+ *
+ * @param cache The file cache
+ * @param entry The entry
+ */
+static void file_cache_link(file_cache *cache, file_cache_entry *entry) {
+  file_cache_list *list = file_cache_list_of(cache, entry);
+
+  entry->prev = NULL;
+  entry->next = list->head;
+
+  if (list->head != NULL) {
+    list->head->prev = entry;
+  } else {
+    list->tail = entry;
+  }
+
+  list->head = entry;
+}
+
+/**
+ * @brief Remove an entry from its usage order
+ *
+ * @param cache The file cache
+ * @param entry The entry
+ */
+static void file_cache_unlink(file_cache *cache, file_cache_entry *entry) {
+  file_cache_list *list = file_cache_list_of(cache, entry);
+
+  if (entry->prev != NULL) {
+    entry->prev->next = entry->next;
+  } else {
+    list->head = entry->next;
+  }
+
+  if (entry->next != NULL) {
+    entry->next->prev = entry->prev;
+  } else {
+    list->tail = entry->prev;
+  }
+}
+
+/**
+ * @brief Remove an entry from the cache and release the reference of the cache
+ *
+ * @param cache The file cache
+ * @param entry The entry to be removed
+ */
+static void file_cache_remove(file_cache *cache, file_cache_entry *entry) {
+  file_cache_entry **link = &cache->buckets[file_cache_bucket(entry->path)];
+
+  while (*link != entry) {
+    link = &(*link)->bucket_next;
+  }
+
+  *link = entry->bucket_next;
+  file_cache_unlink(cache, entry);
+
+  if (entry->error != 0) {
+    cache->negative_count--;
+  } else if (entry->fd >= 0) {
+    cache->descriptor_count--;
+  } else {
+    cache->size -= file_cache_entry_size(entry);
+  }
+
+  entry->cached = false;
+
+  release_file_cache_entry(&entry);
+}
+
+/**
+ * @brief Find the entry of a path
+ *
+ * @param cache The file cache
+ * @param path The path
+ * @return The entry, NULL if the path is not cached
+ */
+static file_cache_entry *file_cache_find(file_cache *cache, string *path) {
+  file_cache_entry *entry = cache->buckets[file_cache_bucket(path)];
+
+  while (entry != NULL && str_cmp(entry->path, get_char_str(path)) != 0) {
+    entry = entry->bucket_next;
+  }
+
+  return entry;
+}
+
+/**
+ * @brief Get the current time of the monotonic clock in seconds (does not access the file system)
+ *
+ * @return The current time
+ */
+static time_t file_cache_now() {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC_COARSE, &now);
+
+  return now.tv_sec;
+}
+
+/**
+ * @brief Create an entry for an opened file
+ *
+ * @param path The path of the file
+ * @param s The status of the file
+ * @param header Serialized data stored with the file (owned by the entry)
+ * @return The entry (without content and file descriptor), NULL if memory allocation fails
+ */
+static file_cache_entry *new_file_cache_entry(string *path, struct stat *s, string *header) {
+  file_cache_entry *entry = calloc(1, sizeof(struct file_cache_entry));
+
+  if (entry == NULL) {
+    return NULL;
+  }
+
+  entry->path = str_cpy(get_char_str(path), get_length(path));
+  entry->fd = -1;
+  entry->header = header;
+  entry->size = s->st_size;
+  entry->mtime = s->st_mtim;
+  entry->device = s->st_dev;
+  entry->inode = s->st_ino;
+
+  return entry;
+}
+
+/**
+ * @brief Add an entry to the cache
+ *
+ * Replaces the previous entry of the path and evicts the least recently used entries of the same
+ * kind until the cache fits its budget (the new entry stays, it fits the budget on its own).
+ *
+ * @param cache The file cache
+ * @param entry The new entry
+ * @return The entry with a reference for the caller
+ */
+static file_cache_entry *file_cache_add(file_cache *cache, file_cache_entry *entry) {
+  entry->validated = file_cache_now();
+  // one reference is held by the cache, one by the caller
+  entry->references = 2;
+  entry->cached = true;
+
+  file_cache_entry *previous = file_cache_find(cache, entry->path);
+
+  if (previous != NULL) {
+    file_cache_remove(cache, previous);
+  }
+
+  size_t bucket = file_cache_bucket(entry->path);
+  entry->bucket_next = cache->buckets[bucket];
+  cache->buckets[bucket] = entry;
+  file_cache_link(cache, entry);
+
+  if (entry->error != 0) {
+    cache->negative_count++;
+
+    while (cache->negative_count > cache->max_negatives && cache->negatives.tail != entry) {
+      file_cache_remove(cache, cache->negatives.tail);
+    }
+  } else if (entry->fd >= 0) {
+    cache->descriptor_count++;
+
+    while (cache->descriptor_count > cache->max_descriptors && cache->descriptors.tail != entry) {
+      file_cache_remove(cache, cache->descriptors.tail);
+    }
+  } else {
+    cache->size += file_cache_entry_size(entry);
+
+    while (cache->size > cache->capacity && cache->contents.tail != entry) {
+      file_cache_remove(cache, cache->contents.tail);
+    }
+  }
+
+  return entry;
+}
+
+file_cache *new_file_cache(size_t capacity, size_t max_file_size, size_t max_descriptors,
+                           size_t max_negatives, time_t revalidate_interval, time_t negative_ttl) {
+  file_cache *cache = calloc(1, sizeof(struct file_cache));
+
+  if (cache == NULL) {
+    return NULL;
+  }
+
+  cache->capacity = capacity;
+  cache->max_file_size = max_file_size < capacity ? max_file_size : capacity;
+  cache->max_descriptors = max_descriptors;
+  cache->max_negatives = max_negatives;
+  cache->revalidate_interval = revalidate_interval;
+  cache->negative_ttl = negative_ttl;
+
+  return cache;
+}
+
+void free_file_cache(file_cache **cache) {
+  if (*cache == NULL) {
+    return;
+  }
+
+  while ((*cache)->contents.head != NULL) {
+    file_cache_remove(*cache, (*cache)->contents.head);
+  }
+
+  while ((*cache)->descriptors.head != NULL) {
+    file_cache_remove(*cache, (*cache)->descriptors.head);
+  }
+
+  while ((*cache)->negatives.head != NULL) {
+    file_cache_remove(*cache, (*cache)->negatives.head);
+  }
+
+  free(*cache);
+  *cache = NULL;
+}
+
+file_cache_entry *file_cache_lookup(file_cache *cache, string *path) {
+  if (cache == NULL || path == NULL) {
+    return NULL;
+  }
+
+  file_cache_entry *entry = file_cache_find(cache, path);
+
+  if (entry == NULL) {
+    return NULL;
+  }
+
+  time_t now = file_cache_now();
+
+  // a failed lookup is not checked again, the path is looked up once the entry expired
+  if (entry->error != 0 && now - entry->validated >= cache->negative_ttl) {
+    file_cache_remove(cache, entry);
+    return NULL;
+  }
+
+  if (entry->error == 0 && now - entry->validated >= cache->revalidate_interval) {
+    struct stat s;
+
+    // the file changed, has been replaced or is gone
+    if (stat(get_char_str(path), &s) != 0 || !S_ISREG(s.st_mode) || s.st_ino != entry->inode ||
+        s.st_dev != entry->device || s.st_size != entry->size ||
+        s.st_mtim.tv_sec != entry->mtime.tv_sec || s.st_mtim.tv_nsec != entry->mtime.tv_nsec) {
+      file_cache_remove(cache, entry);
+      return NULL;
+    }
+
+    entry->validated = now;
+  }
+
+  file_cache_unlink(cache, entry);
+  file_cache_link(cache, entry);
+  entry->references++;
+
+  return entry;
+}
+
+file_cache_entry *file_cache_insert(file_cache *cache, string *path, int fd, string *header) {
+  struct stat s;
+
+  if (cache == NULL || path == NULL || fstat(fd, &s) != 0 || !S_ISREG(s.st_mode) ||
+      (size_t)s.st_size > cache->max_file_size) {
+    free_str(header);
+    return NULL;
+  }
+
+  file_cache_entry *entry = new_file_cache_entry(path, &s, header);
+
+  if (entry == NULL) {
+    free_str(header);
+    return NULL;
+  }
+
+  entry->content = str_reserve(_new_string(), s.st_size);
+
+  char *content = entry->content->str;
+  size_t length = 0;
+
+  while (length < (size_t)s.st_size) {
+    ssize_t read_length = pread(fd, content + length, s.st_size - length, (off_t)length);
+
+    if (read_length < 0 && errno == EINTR) {
+      continue;
+    }
+
+    // the file shrank while it was read
+    if (read_length <= 0) {
+      break;
+    }
+
+    length += read_length;
+  }
+
+  content[length] = '\0';
+  entry->content->len = length;
+
+  if (length != (size_t)s.st_size) {
+    free_file_cache_entry(entry);
+    return NULL;
+  }
+
+  return file_cache_add(cache, entry);
+}
+
+file_cache_entry *file_cache_insert_descriptor(file_cache *cache, string *path, int fd,
+                                               string *header) {
+  struct stat s;
+
+  if (cache == NULL || path == NULL || cache->max_descriptors == 0 || fstat(fd, &s) != 0 ||
+      !S_ISREG(s.st_mode)) {
+    free_str(header);
+    return NULL;
+  }
+
+  file_cache_entry *entry = new_file_cache_entry(path, &s, header);
+
+  if (entry == NULL) {
+    free_str(header);
+    return NULL;
+  }
+
+  entry->fd = fd;
+
+  return file_cache_add(cache, entry);
+}
+
+bool is_cacheable_lookup_error(int error) {
+  switch (error) {
+  case ENOENT:
+  case ENOTDIR:
+  case EACCES:
+  case EXDEV:
+  case ELOOP:
+    return true;
+  default:
+    return false;
+  }
+}
+
+file_cache_entry *file_cache_insert_negative(file_cache *cache, string *path, int error) {
+  if (cache == NULL || path == NULL || cache->max_negatives == 0 ||
+      !is_cacheable_lookup_error(error)) {
+    return NULL;
+  }
+
+  file_cache_entry *entry = calloc(1, sizeof(struct file_cache_entry));
+
+  if (entry == NULL) {
+    return NULL;
+  }
+
+  entry->path = str_cpy(get_char_str(path), get_length(path));
+  entry->fd = -1;
+  entry->error = error;
+
+  return file_cache_add(cache, entry);
+}
+
+void release_file_cache_entry(file_cache_entry **entry) {
+  if (*entry == NULL) {
+    return;
+  }
+
+  (*entry)->references--;
+
+  if ((*entry)->references == 0) {
+    free_file_cache_entry(*entry);
+  }
+
+  *entry = NULL;
+}
@@ -2,6 +2,80 @@
 #define FILE_LIB_H
 
 #include "../string_lib/string_lib.h"
+#include <stdbool.h>
+#include <sys/types.h>
+#include <time.h>
+
+/**
+ * Number of hash buckets of a file cache (must be a power of 2).
+ */
+#define FILE_CACHE_BUCKETS 1024
+
+/**
+ * File held in a file cache, either with its content in memory or (for files that are too large)
+ * as an open file descriptor. Negative entries remember a failed lookup (error is set), they hold
+ * neither content nor file descriptor.
+ * Entries are reference counted: the cache holds a reference as long as the entry is cached and
+ * every user (e.g. a response that is still being sent) holds another one, so an evicted entry
+ * stays valid (and its file descriptor open) until it has been released.
+ */
+struct file_cache_entry {
+  string *path;
+  // NULL if the entry holds a file descriptor
+  string *content;
+  // open file, -1 if the entry holds the content (closed once the entry is freed)
+  int fd;
+  // errno of a failed lookup, 0 if the file exists
+  int error;
+  // serialized data that belongs to the content (e.g. the response headers), set on insert
+  string *header;
+  off_t size;
+  struct timespec mtime;
+  // identity of the file, a file that has been replaced (e.g. renamed over) is not used anymore
+  dev_t device;
+  ino_t inode;
+  // monotonic time of the last check against the file
+  time_t validated;
+  size_t references;
+  bool cached;
+  struct file_cache_entry *bucket_next;
+  struct file_cache_entry *prev;
+  struct file_cache_entry *next;
+} typedef file_cache_entry;
+
+/**
+ * Entries of a file cache ordered by their last use (most recent first).
+ */
+struct file_cache_list {
+  file_cache_entry *head;
+  file_cache_entry *tail;
+} typedef file_cache_list;
+
+/**
+ * Cache of files keyed by their path. Small files are kept in memory and evicted in least recently
+ * used order once the memory budget is exceeded, larger files are kept open and evicted in least
+ * recently used order once there are more than max_descriptors of them. Failed lookups are kept
+ * for negative_ttl seconds (at most max_negatives of them).
+ * @warning A cache is not thread-safe, every thread has to use its own cache
+ */
+struct file_cache {
+  file_cache_entry *buckets[FILE_CACHE_BUCKETS];
+  file_cache_list contents;
+  file_cache_list descriptors;
+  file_cache_list negatives;
+  // bytes used by the cached contents and headers
+  size_t size;
+  size_t capacity;
+  size_t max_file_size;
+  // number of cached file descriptors
+  size_t descriptor_count;
+  size_t max_descriptors;
+  // number of cached failed lookups
+  size_t negative_count;
+  size_t max_negatives;
+  time_t revalidate_interval;
+  time_t negative_ttl;
+} typedef file_cache;
 
 /**
  * @brief Read a file
@@ -14,4 +88,150 @@
  */
 string *read_file(string *path);
 
+/**
+ * @brief Open a regular file for reading
+ * @warning The returned file descriptor must be closed after use
+ *
+ * Returns -1 if the path is NULL, if the file does not exist, is not a regular file or can not be
+ * opened (errno is set, e.g. EACCES if the access is denied).
+ *
+ * @param path The path to the file
+ * @param size Set to the size of the file
+ * @return The file descriptor of the opened file
+ */
+int open_file(string *path, size_t *size);
+
+/**
+ * @brief Open a regular file beneath a directory for reading
+ * @warning The returned file descriptor must be closed after use
+ *
+ * The path is resolved with openat2() relative to the directory, the kernel confines the lookup to
+ * the directory (RESOLVE_BENEATH, requires Linux 5.6 or newer).
+ * Returns -1 if the path is NULL, if the file does not exist, is not a regular file or can not be
+ * opened (errno is set, e.g. EACCES if the access is denied or EXDEV if the path leaves the
+ * directory).
+ *
+ * @param root_fd The directory (may be opened with O_PATH)
+ * @param path The path relative to the directory
+ * @param size Set to the size of the file
+ * @return The file descriptor of the opened file
+ */
+int open_file_beneath(int root_fd, const char *path, size_t *size);
+
+/**
+ * @brief Create a new file cache
+ *
+ * Returns NULL if memory allocation fails.
+ *
+ * @param capacity The memory budget in bytes
+ * @param max_file_size The size of the largest file whose content is cached
+ * @param max_descriptors The number of file descriptors that are kept open, 0 to not cache any
+ * @param max_negatives The number of failed lookups that are kept, 0 to not cache any
+ * @param revalidate_interval Seconds a cached entry is used before it is checked against the file
+ * again
+ * @param negative_ttl Seconds a failed lookup is kept
+ * @return The created file cache
+ */
+file_cache *new_file_cache(size_t capacity, size_t max_file_size, size_t max_descriptors,
+                           size_t max_negatives, time_t revalidate_interval, time_t negative_ttl);
+
+/**
+ * @brief Free a file cache
+ * @warning Entries that are still referenced are freed once they are released
+ *
+ * Returns if the file cache is NULL.
+ *
+ * @param cache File cache to be freed
+ */
+void free_file_cache(file_cache **cache);
+
+/**
+ * @brief Look up the cached content of a file
+ * @warning The returned entry must be released with release_file_cache_entry() after use
+ *
+ * An entry is used without touching the file system for revalidate_interval seconds, afterwards it
+ * is checked with stat() and dropped if the file has been replaced or its modification time or size
+ * changed. Negative entries are not checked, they are dropped after negative_ttl seconds.
+ * Returns NULL if the cache is NULL or the file is not cached (anymore).
+ *
+ * @param cache The file cache
+ * @param path The path of the file
+ * @return The cache entry
+ */
+file_cache_entry *file_cache_lookup(file_cache *cache, string *path);
+
+/**
+ * @brief Read an opened file into the cache
+ * @warning The returned entry must be released with release_file_cache_entry() after use
+ *
+ * The cache takes ownership of the header, the file descriptor stays open. Least recently used
+ * entries are evicted until the cache fits its memory budget.
+ * Returns NULL (and frees the header) if the cache is NULL, the file is larger than max_file_size,
+ * it could not be read or memory allocation fails.
+ *
+ * @param cache The file cache
+ * @param path The path of the file
+ * @param fd The opened file
+ * @param header Serialized data stored with the content (may be NULL)
+ * @return The cache entry
+ */
+file_cache_entry *file_cache_insert(file_cache *cache, string *path, int fd, string *header);
+
+/**
+ * @brief Keep an opened file in the cache without reading it
+ * @warning The returned entry must be released with release_file_cache_entry() after use
+ *
+ * Used for files larger than max_file_size: the entry holds the file descriptor, so later hits
+ * send the file (sendfile()/pread() with an offset) without opening it again. The cache takes
+ * ownership of the header and (on success) of the file descriptor. Least recently used descriptor
+ * entries are evicted until at most max_descriptors are cached.
+ * Returns NULL (frees the header, the file descriptor stays with the caller) if the cache is NULL,
+ * does not cache descriptors, the file is no regular file or memory allocation fails.
+ *
+ * @param cache The file cache
+ * @param path The path of the file
+ * @param fd The opened file
+ * @param header Serialized data stored with the file (may be NULL)
+ * @return The cache entry
+ */
+file_cache_entry *file_cache_insert_descriptor(file_cache *cache, string *path, int fd,
+                                               string *header);
+
+/**
+ * @brief Check whether a failed lookup may be remembered by the file cache
+ *
+ * Only errors that describe the file system (ENOENT, ENOTDIR, EACCES, EXDEV and ELOOP) are
+ * cacheable. Transient errors like EMFILE, ENFILE, ENOMEM or EINTR say nothing about the path.
+ *
+ * @param error The errno of the failed lookup
+ * @return true if the error can be cached
+ */
+bool is_cacheable_lookup_error(int error);
+
+/**
+ * @brief Remember a failed lookup of a path
+ * @warning The returned entry must be released with release_file_cache_entry() after use
+ *
+ * Later lookups of the path return the negative entry without touching the file system until it
+ * expires. Least recently used negative entries are evicted until at most max_negatives are cached.
+ * Returns NULL if the cache is NULL, does not cache failed lookups, the error is not cacheable
+ * (see is_cacheable_lookup_error()) or memory allocation fails.
+ *
+ * @param cache The file cache
+ * @param path The path that could not be opened
+ * @param error The errno of the failed lookup
+ * @return The cache entry
+ */
+file_cache_entry *file_cache_insert_negative(file_cache *cache, string *path, int error);
+
+/**
+ * @brief Release a reference to a cache entry
+ *
+ * The entry is freed once it has been evicted and the last reference is released.
+ * Returns if the entry is NULL. The entry pointer is set to NULL.
+ *
+ * @param entry The entry to be released
+ */
+void release_file_cache_entry(file_cache_entry **entry);
+
 #endif
\ No newline at end of file
@@ -1,7 +1,9 @@
 #include "string_lib.h"
+#include "../arena/arena.h"
 #include <assert.h>
 #include <ctype.h>
 #include <errno.h>
+#include <stdbool.h>
 
 void *exit_err(const char *function_name, const char *reason) {
   fprintf(stderr, "Error - %s(): %s", function_name, reason);
@@ -14,23 +16,114 @@ void *exit_err(const char *function_name, const char *reason) {
   exit(EXIT_FAILURE);
 }
 
+/**
+ * @brief Allocate an empty string with its data directly behind the header
+ *
+ * Returns NULL if the memory allocation fails.
+ *
+ * @param capacity The size of the data (including the null terminator), at least STRING_SMALL_SIZE
+ * @return The string
+ */
+static string *str_alloc(size_t capacity) {
+  if (capacity < STRING_SMALL_SIZE) {
+    capacity = STRING_SMALL_SIZE;
+  }
+
+  string *str = malloc(sizeof(string) + capacity);
+
+  if (str == NULL) {
+    return NULL;
+  }
+
+  str->str = str->data;
+  str->str[0] = '\0';
+  str->len = 0;
+  str->capacity = capacity;
+
+  return str;
+}
+
 string *_new_string() {
-  string *str = calloc(1, sizeof(string));
+  string *str = str_alloc(STRING_SMALL_SIZE);
 
   if (str == NULL) {
     return exit_err("_new_string", "Memory allocation of str failed.");
   }
 
-  str->str = calloc(1, 1);
+  return str;
+}
 
-  if (str->str == NULL) {
-    return exit_err("_new_string", "Memory allocation of str->str failed.");
+/**
+ * @brief Resize the allocation of a string
+ *
+ * Data that is not owned by the string (capacity 0) or stored behind its header is copied into an
+ * allocation of its own.
+ * Exits with code 1 if the memory allocation fails.
+ *
+ * @param dest The string
+ * @param capacity The new size of the allocation (including the null terminator)
+ */
+static void str_resize(string *dest, size_t capacity) {
+  char *str = NULL;
+
+  if (dest->capacity == 0 || dest->str == dest->data) {
+    str = malloc(capacity);
+
+    // a shorter allocation only gets the start of the data
+    if (str != NULL && dest->str != NULL) {
+      memcpy(str, dest->str, dest->len < capacity ? dest->len : capacity - 1);
+    }
+  } else {
+    str = realloc(dest->str, capacity);
   }
 
-  str->str[0] = '\0';
-  str->len = 0;
+  if (str == NULL) {
+    exit_err("str_resize", "Memory allocation of str failed.");
+  }
 
-  return str;
+  dest->str = str;
+  dest->capacity = capacity;
+}
+
+/**
+ * @brief Make room for a string of the given size
+ *
+ * The capacity at least doubles when it grows, so a string built by repeated concatenation is only
+ * reallocated a logarithmic number of times.
+ *
+ * @param dest The string
+ * @param size The required size (including the null terminator)
+ */
+static void str_grow(string *dest, size_t size) {
+  if (size <= dest->capacity) {
+    return;
+  }
+
+  size_t capacity = dest->capacity * 2;
+
+  if (capacity < STRING_SMALL_SIZE) {
+    capacity = STRING_SMALL_SIZE;
+  }
+
+  str_resize(dest, capacity < size ? size : capacity);
+}
+
+string *str_reserve(string *dest, size_t len) {
+  if (dest == NULL) {
+    return NULL;
+  }
+
+  // the content is kept, we need one more byte for the null terminator
+  if (len < dest->len) {
+    len = dest->len;
+  }
+
+  if (len + 1 > dest->capacity) {
+    str_resize(dest, len + 1);
+    dest->str[dest->len] = '\0';
+  }
+
+  return dest;
 }
 
 string *str_set(string *dest, const char *src, size_t len) {
@@ -44,20 +137,38 @@ string *str_set(string *dest, const char *src, size_t len) {
     return dest;
   }
 
-  free(dest->str);
+  // the allocation is reused if it is large enough (we need one more byte for the null terminator)
+  if (len + 1 > dest->capacity) {
+    str_resize(dest, len + 1);
+  }
 
-  // we need to allocate one more byte for the null terminator
-  dest->str = calloc(len + 1, 1);
+  // copy src to dest (src may be a part of dest)
+  memmove(dest->str, src, len);
+
+  dest->str[len] = '\0';
 
-  if (dest->str == NULL) {
-    return exit_err("str_set", "Memory allocation of dest->str failed.");
+  dest->len = len;
+
+  return dest;
+}
+
+string *str_clear(string *dest) { return str_truncate(dest, 0); }
+
+string *str_truncate(string *dest, size_t len) {
+  if (dest == NULL) {
+    return NULL;
   }
 
-  // copy src to dest
-  memcpy(dest->str, src, len);
+  if (len >= dest->len) {
+    return dest;
+  }
 
-  dest->str[len] = '\0';
+  // the allocation is kept for the next content
+  if (dest->capacity == 0) {
+    str_resize(dest, len + 1);
+  }
 
+  dest->str[len] = '\0';
   dest->len = len;
 
   return dest;
@@ -74,14 +185,8 @@ string *str_cat(string *dest, const char *src, size_t len) {
 
   size_t new_len = dest->len + len;
 
-  // we need to allocate one more byte for the null terminator
-  void *temp = realloc(dest->str, new_len + 1);
-
-  if (temp == NULL) {
-    return exit_err("str_cat", "Memory allocation if temp failed.");
-  }
-
-  dest->str = temp;
+  // we need one more byte for the null terminator
+  str_grow(dest, new_len + 1);
 
   memcpy(dest->str + dest->len, src, len);
 
@@ -94,19 +199,13 @@ string *str_cat(string *dest, const char *src, size_t len) {
 string *str_cpy(const char *src, size_t len) {
   assert(src != NULL);
 
-  string *dest = calloc(1, sizeof(string));
+  // we need to allocate one more byte for the null terminator
+  string *dest = str_alloc(len + 1);
 
   if (dest == NULL) {
     return exit_err("str_cpy", "Memory allocation of dest failed.");
   }
 
-  // we need to allocate one more byte for the null terminator
-  dest->str = calloc(1, len + 1);
-
-  if (dest->str == NULL) {
-    return exit_err("str_cpy", "Memory allocation of dest->str failed.");
-  }
-
   memcpy(dest->str, src, len);
   dest->str[len] = '\0';
   dest->len = len;
@@ -126,25 +225,131 @@ int str_cmp(string *str1, const char *str2) {
   return memcmp(str1->str, str2, str1->len);
 }
 
-char *str_str(string *string1, string *pattern) {
-  if (string1 == NULL || pattern == NULL) {
-    return NULL;
+str_view str_view_of(string *str) {
+  if (str == NULL) {
+    return (str_view){.str = "", .len = 0};
   }
 
-  if (pattern->len > string1->len) {
-    return NULL;
+  return (str_view){.str = str->str, .len = str->len};
+}
+
+int str_view_cmp(str_view view, const char *str) {
+  if (view.len != strlen(str)) {
+    return -1;
   }
 
-  for (size_t i = 0; i <= string1->len - pattern->len; i++) {
-    if (string1->str[i] == pattern->str[0]) {
-      for (size_t j = 0; j < pattern->len; j++) {
-        if (string1->str[i + j] != pattern->str[j]) {
-          break;
-        }
+  return memcmp(view.str, str, view.len);
+}
 
-        if (j == pattern->len - 1) {
-          return string1->str + i;
-        }
+bool str_view_equal(str_view view, str_view other) {
+  return view.len == other.len && memcmp(view.str, other.str, view.len) == 0;
+}
+
+/**
+ * @brief Convert an ASCII letter to lower case (independent of the locale)
+ *
+ * @param c The character
+ * @return The lower case character, other characters are returned unchanged
+ */
+static unsigned char ascii_lower(unsigned char c) { return c >= 'A' && c <= 'Z' ? c | 0x20 : c; }
+
+/**
+ * @brief Compare two memory areas ignoring the case of ASCII letters
+ *
+ * @param a The first area
+ * @param b The second area
+ * @param length The length of both areas
+ * @return true if the areas are equal
+ */
+static bool ascii_case_equal(const char *a, const char *b, size_t length) {
+  for (size_t i = 0; i < length; i++) {
+    if (ascii_lower((unsigned char)a[i]) != ascii_lower((unsigned char)b[i])) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+int str_view_case_cmp(str_view view, const char *str) {
+  // header names are compared ASCII-only (RFC 9110), independent of the locale
+  if (view.len != strlen(str) || !ascii_case_equal(view.str, str, view.len)) {
+    return -1;
+  }
+
+  return 0;
+}
+
+str_view str_view_trim(str_view view) {
+  while (view.len > 0 && (view.str[0] == ' ' || view.str[0] == '\t')) {
+    view.str++;
+    view.len--;
+  }
+
+  while (view.len > 0 && (view.str[view.len - 1] == ' ' || view.str[view.len - 1] == '\t')) {
+    view.len--;
+  }
+
+  return view;
+}
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define STR_SIMD_X86
+#include <immintrin.h>
+#endif
+
+/**
+ * Instruction set used by the search functions, detected once when the program is loaded.
+ */
+static str_simd_level str_search_level = STR_SIMD_SCALAR;
+
+/**
+ * @brief Get the best instruction set for the search functions that the CPU supports
+ *
+ * @return The instruction set
+ */
+static str_simd_level supported_simd_level() {
+#ifdef STR_SIMD_X86
+  __builtin_cpu_init();
+
+  if (__builtin_cpu_supports("avx2")) {
+    return STR_SIMD_AVX2;
+  }
+
+  if (__builtin_cpu_supports("sse2")) {
+    return STR_SIMD_SSE2;
+  }
+#endif
+
+  return STR_SIMD_SCALAR;
+}
+
+/**
+ * @brief Select the search functions before main() runs (the level is not changed concurrently)
+ */
+__attribute__((constructor)) static void init_simd_level() {
+  str_search_level = supported_simd_level();
+}
+
+str_simd_level get_str_simd_level() { return str_search_level; }
+
+str_simd_level set_str_simd_level(str_simd_level level) {
+  str_simd_level supported = supported_simd_level();
+
+  str_search_level = level < supported ? level : supported;
+
+  return str_search_level;
+}
+
+/**
+ * @brief Scalar version of str_find_any()
+ */
+static const char *find_any_scalar(const char *data, size_t length, const char *chars,
+                                   size_t count) {
+  for (size_t i = 0; i < length; i++) {
+    for (size_t j = 0; j < count; j++) {
+      if (data[i] == chars[j]) {
+        return data + i;
       }
     }
   }
@@ -152,30 +357,438 @@ char *str_str(string *string1, string *pattern) {
   return NULL;
 }
 
-char *str_str_ignore_case(string *string1, string *pattern) {
-  if (string1 == NULL || pattern == NULL) {
+/**
+ * @brief Scalar version of str_find_control()
+ */
+static const char *find_control_scalar(const char *data, size_t length) {
+  for (size_t i = 0; i < length; i++) {
+    unsigned char c = (unsigned char)data[i];
+
+    if (c < 0x20 || c == 0x7f) {
+      return data + i;
+    }
+  }
+
+  return NULL;
+}
+
+/**
+ * @brief Scalar version of str_find() and str_find_ignore_case()
+ *
+ * Candidates are found by their first byte (with memchr() if the case matters) and then compared
+ * completely.
+ */
+static const char *find_scalar(const char *data, size_t length, const char *needle,
+                               size_t needle_length, bool ignore_case) {
+  unsigned char first = ascii_lower((unsigned char)needle[0]);
+
+  for (size_t i = 0; i + needle_length <= length; i++) {
+    if (!ignore_case) {
+      const char *candidate = memchr(data + i, needle[0], length - needle_length - i + 1);
+
+      if (candidate == NULL) {
+        return NULL;
+      }
+
+      i = candidate - data;
+
+      if (memcmp(data + i, needle, needle_length) == 0) {
+        return data + i;
+      }
+
+      continue;
+    }
+
+    if (ascii_lower((unsigned char)data[i]) == first &&
+        ascii_case_equal(data + i, needle, needle_length)) {
+      return data + i;
+    }
+  }
+
+  return NULL;
+}
+
+#ifdef STR_SIMD_X86
+
+/**
+ * @brief Get the positions of a block of 16 bytes that are any of the given characters
+ *
+ * @return A bit mask with one bit per byte
+ */
+__attribute__((target("sse2"))) static unsigned any_mask_sse2(const char *data,
+                                                              const __m128i *targets,
+                                                              size_t count) {
+  __m128i block = _mm_loadu_si128((const __m128i *)data);
+  __m128i hits = _mm_setzero_si128();
+
+  for (size_t j = 0; j < count; j++) {
+    hits = _mm_or_si128(hits, _mm_cmpeq_epi8(block, targets[j]));
+  }
+
+  return (unsigned)_mm_movemask_epi8(hits);
+}
+
+/**
+ * @brief SSE2 version of str_find_any() (16 bytes per step)
+ *
+ * If the length is not a multiple of 16, the last block overlaps the previous one (the overlapping
+ * positions did not match, so every match in it is new), so only inputs shorter than 16 bytes are
+ * searched by the scalar version.
+ */
+__attribute__((target("sse2"))) static const char *
+find_any_sse2(const char *data, size_t length, const char *chars, size_t count) {
+  __m128i targets[STR_FIND_ANY_MAX];
+
+  if (length < 16) {
+    return find_any_scalar(data, length, chars, count);
+  }
+
+  for (size_t j = 0; j < count; j++) {
+    targets[j] = _mm_set1_epi8(chars[j]);
+  }
+
+  for (size_t i = 0; i < length; i += 16) {
+    // the last block ends with the input
+    size_t start = i + 16 <= length ? i : length - 16;
+    unsigned mask = any_mask_sse2(data + start, targets, count);
+
+    if (mask != 0) {
+      return data + start + __builtin_ctz(mask);
+    }
+  }
+
+  return NULL;
+}
+
+/**
+ * @brief AVX2 version of str_find_any() (32 bytes per step)
+ *
+ * Short inputs and the rest after the last full step are searched by the SSE2 version. The upper
+ * halves of the AVX registers are cleared before, mixing AVX and SSE instructions is slow
+ * otherwise. The same applies to the other AVX2 versions.
+ */
+__attribute__((target("avx2"))) static const char *
+find_any_avx2(const char *data, size_t length, const char *chars, size_t count) {
+  __m256i targets[STR_FIND_ANY_MAX];
+  size_t i = 0;
+
+  if (length < 32) {
+    return find_any_sse2(data, length, chars, count);
+  }
+
+  for (size_t j = 0; j < count; j++) {
+    targets[j] = _mm256_set1_epi8(chars[j]);
+  }
+
+  for (; i + 32 <= length; i += 32) {
+    __m256i block = _mm256_loadu_si256((const __m256i *)(data + i));
+    __m256i hits = _mm256_setzero_si256();
+
+    for (size_t j = 0; j < count; j++) {
+      hits = _mm256_or_si256(hits, _mm256_cmpeq_epi8(block, targets[j]));
+    }
+
+    unsigned mask = (unsigned)_mm256_movemask_epi8(hits);
+
+    if (mask != 0) {
+      _mm256_zeroupper();
+      return data + i + __builtin_ctz(mask);
+    }
+  }
+
+  _mm256_zeroupper();
+
+  if (i == length) {
     return NULL;
   }
 
-  if (pattern->len > string1->len) {
+  // the rest is searched with at least 16 bytes (the overlapping positions did not match)
+  size_t start = length - i >= 16 ? i : length - 16;
+
+  return find_any_sse2(data + start, length - start, chars, count);
+}
+/**
+ * @brief Get the positions of a block of 16 bytes that are control characters
+ *
+ * A byte is a control character if it is not larger than its minimum with 0x1f (unsigned) or if
+ * it is 0x7f.
+ *
+ * @return A bit mask with one bit per byte
+ */
+__attribute__((target("sse2"))) static unsigned control_mask_sse2(const char *data) {
+  __m128i block = _mm_loadu_si128((const __m128i *)data);
+  __m128i hits = _mm_or_si128(_mm_cmpeq_epi8(_mm_min_epu8(block, _mm_set1_epi8(0x1f)), block),
+                              _mm_cmpeq_epi8(block, _mm_set1_epi8(0x7f)));
+
+  return (unsigned)_mm_movemask_epi8(hits);
+}
+
+/**
+ * @brief SSE2 version of str_find_control() (16 bytes per step, see find_any_sse2())
+ */
+__attribute__((target("sse2"))) static const char *find_control_sse2(const char *data,
+                                                                     size_t length) {
+  if (length < 16) {
+    return find_control_scalar(data, length);
+  }
+
+  for (size_t i = 0; i < length; i += 16) {
+    size_t start = i + 16 <= length ? i : length - 16;
+    unsigned mask = control_mask_sse2(data + start);
+
+    if (mask != 0) {
+      return data + start + __builtin_ctz(mask);
+    }
+  }
+
+  return NULL;
+}
+
+/**
+ * @brief AVX2 version of str_find_control() (32 bytes per step, see find_any_avx2())
+ */
+__attribute__((target("avx2"))) static const char *find_control_avx2(const char *data,
+                                                                     size_t length) {
+  __m256i max_control = _mm256_set1_epi8(0x1f);
+  __m256i delete = _mm256_set1_epi8(0x7f);
+  size_t i = 0;
+
+  if (length < 32) {
+    return find_control_sse2(data, length);
+  }
+
+  for (; i + 32 <= length; i += 32) {
+    __m256i block = _mm256_loadu_si256((const __m256i *)(data + i));
+    __m256i hits = _mm256_or_si256(_mm256_cmpeq_epi8(_mm256_min_epu8(block, max_control), block),
+                                   _mm256_cmpeq_epi8(block, delete));
+    unsigned mask = (unsigned)_mm256_movemask_epi8(hits);
+
+    if (mask != 0) {
+      _mm256_zeroupper();
+      return data + i + __builtin_ctz(mask);
+    }
+  }
+
+  _mm256_zeroupper();
+
+  if (i == length) {
     return NULL;
   }
 
-  for (size_t i = 0; i <= string1->len - pattern->len; i++) {
-    if (tolower(string1->str[i]) == tolower(pattern->str[0])) {
-      for (size_t j = 0; j < pattern->len; j++) {
-        if (tolower(string1->str[i + j]) != tolower(pattern->str[j])) {
-          break;
-        }
+  size_t start = length - i >= 16 ? i : length - 16;
+
+  return find_control_sse2(data + start, length - start);
+}
+
+/**
+ * @brief Convert the ASCII letters of a block to lower case
+ */
+__attribute__((target("sse2"))) static __m128i lower_sse2(__m128i block) {
+  // bytes >= 0x80 are negative and therefore never upper case letters
+  __m128i upper = _mm_and_si128(_mm_cmpgt_epi8(block, _mm_set1_epi8('A' - 1)),
+                                _mm_cmplt_epi8(block, _mm_set1_epi8('Z' + 1)));
+
+  return _mm_or_si128(block, _mm_and_si128(upper, _mm_set1_epi8(0x20)));
+}
+
+/**
+ * @brief Convert the ASCII letters of a block to lower case
+ */
+__attribute__((target("avx2"))) static __m256i lower_avx2(__m256i block) {
+  __m256i upper = _mm256_and_si256(_mm256_cmpgt_epi8(block, _mm256_set1_epi8('A' - 1)),
+                                   _mm256_cmpgt_epi8(_mm256_set1_epi8('Z' + 1), block));
+
+  return _mm256_or_si256(block, _mm256_and_si256(upper, _mm256_set1_epi8(0x20)));
+}
+
+/**
+ * @brief SSE2 version of str_find() and str_find_ignore_case()
+ *
+ * Compares the first and the last byte of the needle with 16 positions at once, only positions
+ * where both match are compared completely. The needle has at least 2 bytes.
+ */
+__attribute__((target("sse2"))) static const char *find_sse2(const char *data, size_t length,
+                                                             const char *needle,
+                                                             size_t needle_length,
+                                                             bool ignore_case) {
+  size_t last = needle_length - 1;
+  unsigned char first_char = (unsigned char)needle[0];
+  unsigned char last_char = (unsigned char)needle[last];
+  size_t i = 0;
+
+  if (ignore_case) {
+    first_char = ascii_lower(first_char);
+    last_char = ascii_lower(last_char);
+  }
+
+  __m128i first = _mm_set1_epi8((char)first_char);
+  __m128i end = _mm_set1_epi8((char)last_char);
 
-        if (j == pattern->len - 1) {
-          return string1->str + i;
-        }
+  for (; i + last + 16 <= length; i += 16) {
+    __m128i block_first = _mm_loadu_si128((const __m128i *)(data + i));
+    __m128i block_last = _mm_loadu_si128((const __m128i *)(data + i + last));
+
+    if (ignore_case) {
+      block_first = lower_sse2(block_first);
+      block_last = lower_sse2(block_last);
+    }
+
+    unsigned mask = (unsigned)_mm_movemask_epi8(
+        _mm_and_si128(_mm_cmpeq_epi8(block_first, first), _mm_cmpeq_epi8(block_last, end)));
+
+    while (mask != 0) {
+      const char *candidate = data + i + __builtin_ctz(mask);
+
+      if (ignore_case ? ascii_case_equal(candidate + 1, needle + 1, last - 1)
+                      : memcmp(candidate + 1, needle + 1, last - 1) == 0) {
+        return candidate;
       }
+
+      mask &= mask - 1;
     }
   }
 
-  return NULL;
+  return find_scalar(data + i, length - i, needle, needle_length, ignore_case);
+}
+
+/**
+ * @brief AVX2 version of str_find() and str_find_ignore_case() (32 positions per step, see
+ * find_any_avx2())
+ */
+__attribute__((target("avx2"))) static const char *find_avx2(const char *data, size_t length,
+                                                             const char *needle,
+                                                             size_t needle_length,
+                                                             bool ignore_case) {
+  size_t last = needle_length - 1;
+  unsigned char first_char = (unsigned char)needle[0];
+  unsigned char last_char = (unsigned char)needle[last];
+  size_t i = 0;
+
+  if (length < needle_length + 31) {
+    return find_sse2(data, length, needle, needle_length, ignore_case);
+  }
+
+  if (ignore_case) {
+    first_char = ascii_lower(first_char);
+    last_char = ascii_lower(last_char);
+  }
+
+  __m256i first = _mm256_set1_epi8((char)first_char);
+  __m256i end = _mm256_set1_epi8((char)last_char);
+
+  for (; i + last + 32 <= length; i += 32) {
+    __m256i block_first = _mm256_loadu_si256((const __m256i *)(data + i));
+    __m256i block_last = _mm256_loadu_si256((const __m256i *)(data + i + last));
+
+    if (ignore_case) {
+      block_first = lower_avx2(block_first);
+      block_last = lower_avx2(block_last);
+    }
+
+    unsigned mask = (unsigned)_mm256_movemask_epi8(_mm256_and_si256(
+        _mm256_cmpeq_epi8(block_first, first), _mm256_cmpeq_epi8(block_last, end)));
+
+    while (mask != 0) {
+      const char *candidate = data + i + __builtin_ctz(mask);
+
+      if (ignore_case ? ascii_case_equal(candidate + 1, needle + 1, last - 1)
+                      : memcmp(candidate + 1, needle + 1, last - 1) == 0) {
+        return candidate;
+      }
+
+      mask &= mask - 1;
+    }
+  }
+
+  _mm256_zeroupper();
+
+  return find_sse2(data + i, length - i, needle, needle_length, ignore_case);
+}
+
+#endif
+
+const char *str_find_any(str_view view, const char *chars, size_t count) {
+  if (view.len == 0 || count == 0 || count > STR_FIND_ANY_MAX) {
+    return NULL;
+  }
+
+#ifdef STR_SIMD_X86
+  if (str_search_level == STR_SIMD_AVX2) {
+    return find_any_avx2(view.str, view.len, chars, count);
+  }
+
+  if (str_search_level == STR_SIMD_SSE2) {
+    return find_any_sse2(view.str, view.len, chars, count);
+  }
+#endif
+
+  return find_any_scalar(view.str, view.len, chars, count);
+}
+
+const char *str_find_control(str_view view) {
+#ifdef STR_SIMD_X86
+  if (str_search_level == STR_SIMD_AVX2) {
+    return find_control_avx2(view.str, view.len);
+  }
+
+  if (str_search_level == STR_SIMD_SSE2) {
+    return find_control_sse2(view.str, view.len);
+  }
+#endif
+
+  return find_control_scalar(view.str, view.len);
+}
+
+/**
+ * @brief Find a needle with the selected instruction set
+ *
+ * @param view The view to search in
+ * @param needle The needle
+ * @param ignore_case Whether the case of ASCII letters is ignored
+ * @return The first occurrence, NULL if there is none or the needle is empty
+ */
+static const char *find(str_view view, str_view needle, bool ignore_case) {
+  if (needle.len == 0 || needle.len > view.len) {
+    return NULL;
+  }
+
+  if (needle.len == 1 && !ignore_case) {
+    return memchr(view.str, needle.str[0], view.len);
+  }
+
+#ifdef STR_SIMD_X86
+  if (needle.len > 1 && str_search_level == STR_SIMD_AVX2) {
+    return find_avx2(view.str, view.len, needle.str, needle.len, ignore_case);
+  }
+
+  if (needle.len > 1 && str_search_level == STR_SIMD_SSE2) {
+    return find_sse2(view.str, view.len, needle.str, needle.len, ignore_case);
+  }
+#endif
+
+  return find_scalar(view.str, view.len, needle.str, needle.len, ignore_case);
+}
+
+const char *str_find(str_view view, str_view needle) { return find(view, needle, false); }
+
+const char *str_find_ignore_case(str_view view, str_view needle) {
+  return find(view, needle, true);
+}
+
+char *str_str(string *string1, string *pattern) {
+  if (string1 == NULL || pattern == NULL) {
+    return NULL;
+  }
+
+  return (char *)str_find(str_view_of(string1), str_view_of(pattern));
+}
+
+char *str_str_ignore_case(string *string1, string *pattern) {
+  if (string1 == NULL || pattern == NULL) {
+    return NULL;
+  }
+
+  return (char *)str_find_ignore_case(str_view_of(string1), str_view_of(pattern));
 }
 
 void str_to_lower(string *input) {
@@ -270,11 +883,146 @@ char *get_char_str(string *str) {
   return str->str;
 }
 
+string *str_borrow(string *dest, const char *src, size_t len) {
+  if (dest == NULL) {
+    return NULL;
+  }
+
+  if (dest->capacity != 0 && dest->str != dest->data) {
+    free(dest->str);
+  }
+
+  dest->str = (char *)src;
+  dest->len = len;
+  dest->capacity = 0;
+
+  return dest;
+}
+
 void free_str(string *str) {
   if (str == NULL || str->str == NULL) {
     return;
   }
 
-  free(str->str);
+  // data stored behind the header is freed together with it, borrowed data is not freed at all
+  if (str->capacity != 0 && str->str != str->data) {
+    free(str->str);
+  }
+
   free(str);
-}
\ No newline at end of file
+}
+
+string *new_string_arena(arena *arena) {
+  if (arena == NULL) {
+    return _new_string();
+  }
+
+  return str_cpy_arena(arena, "", 0);
+}
+
+string *str_cpy_arena(arena *arena, const char *src, size_t len) {
+  if (arena == NULL) {
+    return str_cpy(src, len);
+  }
+
+  assert(src != NULL);
+
+  // the data is stored behind the header, concatenations can grow it in place
+  size_t capacity = len + 1 < STRING_SMALL_SIZE ? STRING_SMALL_SIZE : len + 1;
+  string *dest = arena_alloc(arena, sizeof(string) + capacity);
+
+  if (dest == NULL) {
+    return exit_err("str_cpy_arena", "Memory allocation of dest failed.");
+  }
+
+  dest->str = dest->data;
+  memcpy(dest->str, src, len);
+  dest->str[len] = '\0';
+  dest->len = len;
+  dest->capacity = capacity;
+
+  return dest;
+}
+
+string *str_cat_arena(arena *arena, string *dest, const char *src, size_t len) {
+  if (arena == NULL) {
+    return str_cat(dest, src, len);
+  }
+
+  if (dest == NULL) {
+    return NULL;
+  }
+
+  if (src == NULL || len <= 0) {
+    return dest;
+  }
+
+  size_t new_len = dest->len + len;
+
+  // the last allocation of the arena (the data or the string with its data) grows in place, we
+  // need one more byte for the null terminator
+  if (new_len + 1 > dest->capacity) {
+    char *start = dest->str == dest->data ? (char *)dest : dest->str;
+    size_t offset = dest->str - start;
+
+    if (arena_extend(arena, start, offset + new_len + 1)) {
+      dest->capacity = new_len + 1;
+    }
+  }
+
+  if (new_len + 1 > dest->capacity) {
+    size_t capacity = dest->capacity * 2 < new_len + 1 ? new_len + 1 : dest->capacity * 2;
+    char *str = arena_alloc(arena, capacity);
+
+    if (str == NULL) {
+      return exit_err("str_cat_arena", "Memory allocation of str failed.");
+    }
+
+    memcpy(str, dest->str, dest->len);
+    dest->str = str;
+    dest->capacity = capacity;
+  }
+
+  memcpy(dest->str + dest->len, src, len);
+
+  dest->str[new_len] = '\0';
+  dest->len = new_len;
+
+  return dest;
+}
+
+string *size_t_to_string_arena(arena *arena, size_t num) {
+  if (arena == NULL) {
+    return size_t_to_string(num);
+  }
+
+  char digits[24];
+  int length = snprintf(digits, sizeof(digits), "%zu", num);
+
+  return str_cpy_arena(arena, digits, length);
+}
+
+string *int_to_string_arena(arena *arena, int num) {
+  if (arena == NULL) {
+    return int_to_string(num);
+  }
+
+  char digits[16];
+  int length = snprintf(digits, sizeof(digits), "%d", num);
+
+  return str_cpy_arena(arena, digits, length);
+}
+
+string *str_borrow_arena(arena *arena, const char *src, size_t len) {
+  string *dest = arena == NULL ? malloc(sizeof(string)) : arena_alloc(arena, sizeof(string));
+
+  if (dest == NULL) {
+    return exit_err("str_borrow_arena", "Memory allocation of dest failed.");
+  }
+
+  dest->str = (char *)src;
+  dest->len = len;
+  dest->capacity = 0;
+
+  return dest;
+}
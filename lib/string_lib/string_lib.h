@@ -1,15 +1,75 @@
 #ifndef STRING_LIB_H
 #define STRING_LIB_H
 
+#include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+/**
+ * Minimum size of the data stored inline behind the header of a string (including the null
+ * terminator), short strings never need a second allocation. Also the smallest allocation of a
+ * string that grows.
+ */
+#define STRING_SMALL_SIZE 24
+
+/**
+ * Null terminated string with its length.
+ *
+ * A created string is a single allocation: str points to the data directly behind the header until
+ * the string outgrows it, only then the data is moved to an allocation of its own. capacity is the
+ * size of the memory str points to (including the null terminator), it is 0 if the string does not
+ * own its data (e.g. a string literal or a part of a buffer). Such a string is copied into an
+ * allocation of its own once it is changed.
+ * @warning The inline data only exists for strings created by string_lib, a string must not be
+ * copied by value if it has been created by string_lib
+ */
 struct string {
   size_t len;
   char *str;
+  size_t capacity;
+  char data[];
 } typedef string;
 
+/**
+ * Borrowed part of another string or buffer (pointer and length).
+ * @warning A view does not own its data and is not null terminated
+ */
+struct str_view {
+  const char *str;
+  size_t len;
+} typedef str_view;
+
+/**
+ * Length of a string literal, computed at compile time (fails to compile for anything else).
+ */
+#define STR_LITERAL_LEN(literal) (sizeof("" literal) - 1)
+
+/**
+ * Initializer of a static string of a string literal (e.g. for a string with static storage
+ * duration): the data is borrowed and the length is computed at compile time.
+ */
+#define STR_LITERAL_INIT(literal)                                                                  \
+  { .len = STR_LITERAL_LEN(literal), .str = (char *)("" literal), .capacity = 0 }
+
+/**
+ * Static string of a string literal that never touches the heap. It can be passed wherever a
+ * string is only read, e.g. `str_str(path, &STR_LITERAL(".."))`.
+ * @warning The string must not be freed, it is copied into an allocation of its own once it is
+ * changed
+ */
+#define STR_LITERAL(literal) ((string)STR_LITERAL_INIT(literal))
+
+/**
+ * View of a string literal, the length is computed at compile time.
+ */
+#define STR_VIEW_LITERAL(literal) ((str_view){.str = ("" literal), .len = STR_LITERAL_LEN(literal)})
+
+/**
+ * Bump allocator the *_arena variants allocate from (see lib/arena/arena.h).
+ */
+typedef struct arena arena;
+
 /**
  * @brief Exit the program with an error message
  *
@@ -31,9 +91,8 @@ void *exit_err(const char *function_name, const char *reason);
 string *_new_string();
 
 /**
- * @brief Set a string to another string by freeing the destination string and allocating memory for
- * the source string
- * @warning The destination will be reallocated
+ * @brief Set a string to another string
+ * @warning The destination is reallocated if its capacity is too small
  * @warning This function will add a null terminator to the end of the string that is not included
  * in the length
  *
@@ -50,9 +109,10 @@ string *str_set(string *dest, const char *src, size_t len);
 
 /**
  * @brief Concatenate a string to another string
- * @warning The destination will be reallocated
+ * @warning The destination is reallocated if its capacity is too small
  * @warning This function will add a null terminator to the end of the string
  *
+ * The capacity grows geometrically, appending in small steps costs O(1) amortized allocations.
  * Returns NULL if the destination string is NULL.
  * Returns the destination string if the source string is NULL or len is 0.
  * Exits with code 1 if the memory allocation fails.
@@ -64,6 +124,41 @@ string *str_set(string *dest, const char *src, size_t len);
  */
 string *str_cat(string *dest, const char *src, size_t len);
 
+/**
+ * @brief Make room for a string of the given length
+ *
+ * Content that is appended afterwards up to that length does not reallocate the string.
+ * Returns NULL if the string is NULL.
+ * Exits with code 1 if the memory allocation fails.
+ *
+ * @param dest The string
+ * @param len The length the string can grow to
+ * @return The string
+ */
+string *str_reserve(string *dest, size_t len);
+
+/**
+ * @brief Remove the content of a string, its allocation is kept for the next content
+ *
+ * Returns NULL if the string is NULL.
+ *
+ * @param dest The string
+ * @return The string
+ */
+string *str_clear(string *dest);
+
+/**
+ * @brief Shorten a string to the given length, its allocation is kept
+ *
+ * Returns NULL if the string is NULL.
+ * Returns the string unchanged if it is not longer than len.
+ *
+ * @param dest The string
+ * @param len The new length
+ * @return The string
+ */
+string *str_truncate(string *dest, size_t len);
+
 /**
  * @brief Copy a string
  * @warning The destination will be reallocated
@@ -91,6 +186,134 @@ string *str_cpy(const char *src, size_t len);
  */
 int str_cmp(string *str1, const char *str2);
 
+/**
+ * @brief Get a view of a string
+ *
+ * Returns an empty view if the string is NULL.
+ *
+ * @param str The string
+ * @return The view of the whole string
+ */
+str_view str_view_of(string *str);
+
+/**
+ * @brief Compare a view with a string
+ *
+ * Returns 0 if the view and the string are equal.
+ * Returns -1 if the lengths differ, otherwise the result of memcmp().
+ *
+ * @param view The view
+ * @param str The string (null terminated)
+ * @return The comparison result
+ */
+int str_view_cmp(str_view view, const char *str);
+
+/**
+ * @brief Check if two views are equal
+ *
+ * Compares the lengths first, so a view compared with STR_VIEW_LITERAL() never scans the literal.
+ *
+ * @param view The view
+ * @param other The other view
+ * @return true if both views have the same content
+ */
+bool str_view_equal(str_view view, str_view other);
+
+/**
+ * @brief Compare a view with a string ignoring the case (ASCII)
+ *
+ * Returns 0 if the view and the string are equal ignoring the case, -1 otherwise.
+ *
+ * @param view The view
+ * @param str The string (null terminated)
+ * @return The comparison result
+ */
+int str_view_case_cmp(str_view view, const char *str);
+
+/**
+ * @brief Remove leading and trailing spaces and tabs from a view
+ *
+ * @param view The view
+ * @return The trimmed view
+ */
+str_view str_view_trim(str_view view);
+
+/**
+ * Instruction sets of the search functions (str_find_any(), str_find_control(), str_find() and
+ * str_find_ignore_case()), every level includes the previous ones.
+ */
+enum str_simd_level { STR_SIMD_SCALAR, STR_SIMD_SSE2, STR_SIMD_AVX2 } typedef str_simd_level;
+
+/**
+ * Maximum number of characters str_find_any() searches for at once.
+ */
+#define STR_FIND_ANY_MAX 4
+
+/**
+ * @brief Get the instruction set used by the search functions
+ *
+ * The best instruction set the CPU supports is selected when the program is loaded.
+ *
+ * @return The instruction set
+ */
+str_simd_level get_str_simd_level();
+
+/**
+ * @brief Select the instruction set used by the search functions (for tests and benchmarks)
+ * @warning Not thread-safe, the level must not be changed while other threads search
+ *
+ * Levels that the CPU does not support are lowered to the best supported one.
+ *
+ * @param level The instruction set
+ * @return The selected instruction set
+ */
+str_simd_level set_str_simd_level(str_simd_level level);
+
+/**
+ * @brief Find the first occurrence of any of the given characters
+ *
+ * Searches 16 (SSE2) or 32 (AVX2) bytes per step, e.g. for the delimiters of a request line.
+ * Returns NULL if count is 0 or larger than STR_FIND_ANY_MAX.
+ *
+ * @param view The view to search in
+ * @param chars The characters to search for (may contain '\0')
+ * @param count The number of characters
+ * @return The first occurrence, NULL if none of the characters is found
+ */
+const char *str_find_any(str_view view, const char *chars, size_t count);
+
+/**
+ * @brief Find the first ASCII control character (0x00 - 0x1f and 0x7f)
+ *
+ * Used to skip the regular bytes of header values at once (CR, LF and HTAB are control characters
+ * as well).
+ *
+ * @param view The view to search in
+ * @return The first control character, NULL if there is none
+ */
+const char *str_find_control(str_view view);
+
+/**
+ * @brief Find the first occurrence of a needle
+ *
+ * The SIMD versions compare the first and the last byte of the needle with many positions at once
+ * and only compare the candidates completely.
+ *
+ * @param view The view to search in
+ * @param needle The needle
+ * @return The first occurrence, NULL if there is none or the needle is empty
+ */
+const char *str_find(str_view view, str_view needle);
+
+/**
+ * @brief Find the first occurrence of a needle ignoring the case of ASCII letters
+ *
+ * @param view The view to search in
+ * @param needle The needle
+ * @return The first occurrence, NULL if there is none or the needle is empty
+ */
+const char *str_find_ignore_case(str_view view, str_view needle);
+
 /**
  * @brief finds 1st appearance of the pattern in a string
  *
@@ -103,7 +326,7 @@ int str_cmp(string *str1, const char *str2);
 char *str_str(string *string1, string *pattern);
 
 /**
- * @brief finds 1st appearance of the pattern in a string
+ * @brief finds 1st appearance of the pattern in a string (ignoring the case of ASCII letters)
  *
  * Returns char* to the 1st appearance of the pattern
  * Returns NULL if pattern is not in the string
@@ -181,13 +404,117 @@ size_t get_length(string *str);
  */
 char *get_char_str(string *str);
 
+/**
+ * @brief Set a string to static data without copying it
+ * @warning The data has to stay valid as long as the string uses it (e.g. a string literal)
+ *
+ * The string borrows the data (its capacity is 0) until it is changed, then the data is copied into
+ * an allocation of its own. Own data of the string is freed.
+ * Returns NULL if the destination string is NULL.
+ *
+ * @param dest The destination string
+ * @param src The static data
+ * @param len The length of the data
+ * @return The destination string
+ */
+string *str_borrow(string *dest, const char *src, size_t len);
+
 /**
  * @brief Free a string
  *
- * Returns if the string is NULL.
+ * Returns if the string is NULL. Borrowed data (see str_borrow()) is not freed.
  *
  * @param str The string to free
  */
 void free_str(string *str);
 
+/**
+ * @brief Create a new string in an arena
+ * @warning The string must not be freed, it is released together with the arena
+ *
+ * Same as _new_string() if the arena is NULL.
+ * Exits with code 1 if the memory allocation fails.
+ *
+ * @param arena The arena
+ * @return The new string
+ */
+string *new_string_arena(arena *arena);
+
+/**
+ * @brief Copy a string into an arena
+ * @warning The string must not be freed, it is released together with the arena
+ *
+ * Same as str_cpy() if the arena is NULL.
+ * Exits with code 1 if the memory allocation fails.
+ *
+ * @param arena The arena
+ * @param src The source string
+ * @param len The length of the source string
+ * @return The copied string
+ */
+string *str_cpy_arena(arena *arena, const char *src, size_t len);
+
+/**
+ * @brief Concatenate a string to a string of an arena
+ * @warning The destination has to be allocated from the same arena
+ *
+ * The destination grows in place if it is the last allocation of the arena (e.g. while a string is
+ * built by repeated concatenation), otherwise it is moved to a new allocation of the arena.
+ * Same as str_cat() if the arena is NULL.
+ *
+ * Returns NULL if the destination string is NULL.
+ * Returns the destination string if the source string is NULL or len is 0.
+ * Exits with code 1 if the memory allocation fails.
+ *
+ * @param arena The arena
+ * @param dest The destination string
+ * @param src The source string
+ * @param len The length of the source string
+ * @return The destination string
+ */
+string *str_cat_arena(arena *arena, string *dest, const char *src, size_t len);
+
+/**
+ * @brief Convert a size_t to a string of an arena
+ * @warning The string must not be freed, it is released together with the arena
+ *
+ * Same as size_t_to_string() if the arena is NULL.
+ * Exits with code 1 if the memory allocation fails.
+ *
+ * @param arena The arena
+ * @param num The size_t
+ * @return The string
+ */
+string *size_t_to_string_arena(arena *arena, size_t num);
+
+/**
+ * @brief Convert an int to a string of an arena
+ * @warning The string must not be freed, it is released together with the arena
+ *
+ * Same as int_to_string() if the arena is NULL.
+ * Exits with code 1 if the memory allocation fails.
+ *
+ * @param arena The arena
+ * @param num The int
+ * @return The string
+ */
+string *int_to_string_arena(arena *arena, int num);
+
+/**
+ * @brief Create a string of an arena that borrows static data
+ * @warning The data has to stay valid as long as the string uses it, the string must not be freed
+ * (it is released together with the arena)
+ *
+ * Only the string header is allocated, the data is not copied (see str_borrow()).
+ * If the arena is NULL, the header is allocated on the heap and must be freed with free_str() (the
+ * data is not freed).
+ * Exits with code 1 if the memory allocation fails.
+ *
+ * @param arena The arena
+ * @param src The static data
+ * @param len The length of the data
+ * @return The string
+ */
+string *str_borrow_arena(arena *arena, const char *src, size_t len);
+
 #endif
\ No newline at end of file
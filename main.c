@@ -1,16 +1,33 @@
 #include "main.h"
 #include "lib/string_lib/string_lib.h"
+#include "src/event_loop/event_loop.h"
+#include "src/http_router/http_router.h"
 #include "src/http_server/http_server.h"
+#include "src/io_uring_loop/io_uring_loop.h"
 #include <errno.h>
 #include <netinet/ip.h>
+#include <pthread.h>
 #include <signal.h>
+#include <stdatomic.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/eventfd.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <unistd.h>
 
-static bool run = true;
+struct server_options {
+  bool use_stdin;
+  bool use_io_uring;
+  long workers;
+} typedef server_options;
+
+static atomic_bool run = true;
+
+/// eventfd that wakes up all workers once the server is stopped
+static int wake_fd = -1;
 
 /**
  * @brief Handle the socket signal
@@ -24,12 +41,22 @@ static void handle_signal(int signum) {
     exit_err("handle_signal", "unexpected signal");
   }
 
+  int saved_errno = errno;
+
   // exit the server after the last client has been processed.
   run = false;
+
+  // wake up all workers blocked in epoll_wait() (write() is async-signal-safe)
+  if (wake_fd >= 0) {
+    uint64_t value = 1;
+    write(wake_fd, &value, sizeof(value));
+  }
+
+  errno = saved_errno;
 }
 
 /**
- * @brief Registers the signal handler for SIGINT
+ * @brief Registers the signal handler for SIGINT and ignores SIGPIPE
  *
  * Exists with error if the signal handler could not be registered
  */
@@ -44,12 +71,20 @@ static void register_signal() {
   if (sigaction(SIGINT, &action, NULL) < 0) {
     exit_err("register_signal", "registering signal handler");
   }
+
+  // sendfile() and splice() have no MSG_NOSIGNAL, a client that went away must not kill the server
+  action.sa_handler = SIG_IGN;
+
+  if (sigaction(SIGPIPE, &action, NULL) < 0) {
+    exit_err("register_signal", "ignoring SIGPIPE");
+  }
 }
 
 /**
  * @brief Set up the socket
  *
- * Creates a socket and binds it to the server configuration.
+ * Creates a socket and binds it to the server configuration. Every worker sets up its own socket,
+ * SO_REUSEPORT lets the kernel distribute incoming connections between them.
  * Exits with error if the socket could not be created or bound.
  *
  * @return the socket file descriptor
@@ -77,6 +112,11 @@ static int setup_socket() {
     exit_err("setup_socket", "on setsockopt");
   }
 
+  // allow every worker to bind its own socket to the same port
+  if (setsockopt(sock_fd, SOL_SOCKET, SO_REUSEPORT, (const char *)&opt, sizeof(int)) < 0) {
+    exit_err("setup_socket", "on setsockopt");
+  }
+
   // allow the socket to accept connections
   if (bind(sock_fd, (struct sockaddr *)&serv_addr, sizeof(serv_addr)) < 0) {
     exit_err("setup_socket", "on binding");
@@ -95,120 +135,234 @@ static int setup_socket() {
  *
  * Processes the incoming request and returns the response.
  *
- * @param request the incoming request
+ * @param request the incoming request (borrowed from the receive buffer)
+ * @param keep_alive in: the connection may stay open, out: the connection stays open
+ * @param arena the arena of the connection the response can be allocated from
  * @return the response
  */
-string *process(string *request) {
-  string *response = http_server(request);
-  free_str(request);
-
-  return response;
+encoded_response_t *process(string *request, bool *keep_alive, arena *arena) {
+  return http_server(request, keep_alive, arena);
 }
 
 /**
  * @brief Main loop for the server (stdin)
  *
- * The main loop for the server. Accepts incoming connections and processes them.
+ * The main loop for the server. Reads a single request from stdin and writes the response to
+ * stdout. The request is read until its head is complete, stdin ends or it exceeds
+ * HTTP_MAX_REQUEST_SIZE bytes.
  */
 static void main_loop_stdin() {
-  void *const buffer = malloc(SERVER_BUFFER_SIZE);
+  buffer_pool *pool = new_buffer_pool();
+  buffer_t *buffer = pool == NULL ? NULL : acquire_buffer(pool, CONNECTION_BUFFER_SIZE);
 
   if (buffer == NULL) {
     exit_err("main_loop_stdin", "at malloc.");
   }
 
-  // read incoming data from buffer
-  memset(buffer, 0, SERVER_BUFFER_SIZE);
-  size_t length = read(STDIN_FILENO, buffer, SERVER_BUFFER_SIZE - 1);
+  string request = buffer_string(buffer);
+  request_parser parser;
+  reset_request_parser(&parser);
+
+  // every read only parses the new bytes
+  while (parse_request_incremental(&parser, buffer->data, buffer->length) ==
+         REQUEST_PARSE_INCOMPLETE) {
+    if (buffer->length == buffer->capacity && !grow_buffer(pool, &buffer, buffer->capacity * 2)) {
+      exit_err("main_loop_stdin", "at malloc.");
+    }
+
+    ssize_t length =
+        read(STDIN_FILENO, buffer->data + buffer->length, buffer->capacity - buffer->length);
+
+    if (length < 0 && errno == EINTR) {
+      continue;
+    }
+
+    if (length < 0) {
+      exit_err("main_loop_stdin", "reading from stdin");
+    }
+
+    if (length == 0) {
+      break;
+    }
+
+    buffer->length += length;
+    request = buffer_string(buffer);
+  }
+
+  bool keep_alive = false;
+  arena response_arena;
+  init_arena(&response_arena, pool);
+  encoded_response_t *response = process(&request, &keep_alive, &response_arena);
 
-  if (length < 0 && errno != EINTR) {
-    exit_err("main_loop_stdin", "reading from socket");
+  if (response == NULL) {
+    exit_err("main_loop_stdin", "processing the request");
   }
 
-  string *request = str_cpy(buffer, length);
-  string *response = process(request);
+  string *cached = response->cached == NULL ? NULL : response->cached->content;
 
-  size_t response_len = get_length(response);
-  char *response_char = get_char_str(response);
+  // write head and body with a single call, the body is not copied behind the head
+  struct iovec segments[] = {
+      {.iov_base = response->head->str, .iov_len = get_length(response->head)},
+      {.iov_base = response->body == NULL ? NULL : response->body->str,
+       .iov_len = response->body == NULL ? 0 : get_length(response->body)},
+      {.iov_base = cached == NULL ? NULL : cached->str,
+       .iov_len = cached == NULL ? 0 : get_length(cached)}};
 
-  // write outgoing data to buffer
-  if (write(STDOUT_FILENO, response_char, response_len) < 0) {
+  if (writev(STDOUT_FILENO, segments, 3) < 0) {
     exit_err("main_loop_stdin", "writing to STDOUT");
   }
 
-  free_str(response);
-  free(buffer);
+  // STDOUT can be anything (e.g. a terminal), so a file body is copied through the buffer instead
+  // of being sent with sendfile()
+  off_t offset = response->file_offset;
+  size_t remaining = response->file_length;
+
+  while (remaining > 0) {
+    size_t chunk = remaining < buffer->capacity ? remaining : buffer->capacity;
+    ssize_t length = pread(response->file_fd, buffer->data, chunk, offset);
+
+    if (length < 0 && errno == EINTR) {
+      continue;
+    }
+
+    if (length <= 0) {
+      exit_err("main_loop_stdin", "reading the file");
+    }
+
+    if (write(STDOUT_FILENO, buffer->data, length) != length) {
+      exit_err("main_loop_stdin", "writing to STDOUT");
+    }
+
+    offset += length;
+    remaining -= length;
+  }
+
+  free_encoded_response(&response);
+  release_arena(&response_arena);
+  free_router_file_cache();
+  release_buffer(pool, &buffer);
+  free_buffer_pool(&pool);
 }
 
 /**
- * @brief Main loop for the server
+ * @brief Worker thread of the server
+ *
+ * Every worker owns a listening socket and runs its own event loop until the server is stopped.
  *
- * The main loop for the server. Accepts incoming connections and processes them.
+ * @param arg the server options
+ * @return NULL
  */
-static void main_loop() {
+static void *worker(void *arg) {
+  const server_options *options = arg;
+
   const int sock_fd = setup_socket();
-  int new_sock_fd;
-  ssize_t length;
 
-  struct sockaddr_in client_addr;
-  socklen_t client_len = sizeof(client_addr);
+  if (options->use_io_uring) {
+    io_uring_loop(sock_fd, wake_fd, process, &run);
+  } else {
+    event_loop(sock_fd, wake_fd, process, &run);
+  }
 
-  void *const buffer = malloc(SERVER_BUFFER_SIZE);
+  free_router_file_cache();
 
-  if (buffer == NULL) {
-    exit_err("main_loop", "at malloc.");
+  if (close(sock_fd) < 0) {
+    exit_err("worker", "on close");
   }
 
-  while (run) {
-    // block until a client connects
-    new_sock_fd = accept(sock_fd, (struct sockaddr *)&client_addr, &client_len);
+  return NULL;
+}
 
-    if (new_sock_fd < 0) {
-      if (errno == EINTR) {
-        break;
-      }
+/**
+ * @brief Main loop for the server
+ *
+ * Starts the workers and waits until all of them have stopped.
+ * Exits with error if a worker could not be started.
+ *
+ * @param options the server options
+ */
+static void main_loop(const server_options *options) {
+  const long workers = options->workers;
+  pthread_t *threads = calloc(workers, sizeof(pthread_t));
 
-      exit_err("main_loop", "on accept");
-    }
+  if (threads == NULL) {
+    exit_err("main_loop", "at calloc.");
+  }
 
-    // read the incoming data from the socket
-    memset(buffer, 0, SERVER_BUFFER_SIZE);
-    length = read(new_sock_fd, buffer, SERVER_BUFFER_SIZE - 1);
+  wake_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
 
-    if (length < 0) {
-      if (errno == EINTR) {
-        break;
-      }
+  if (wake_fd < 0) {
+    exit_err("main_loop", "on eventfd");
+  }
 
-      exit_err("main_loop", "reading from socket");
+  for (long i = 0; i < workers; i++) {
+    if (pthread_create(&threads[i], NULL, worker, (void *)options) != 0) {
+      exit_err("main_loop", "on pthread_create");
     }
+  }
+
+  for (long i = 0; i < workers; i++) {
+    pthread_join(threads[i], NULL);
+  }
+
+  if (close(wake_fd) < 0) {
+    exit_err("main_loop", "on close");
+  }
 
-    string *request = str_cpy(buffer, length);
-    string *response = process(request);
+  free(threads);
+}
 
-    size_t response_len = get_length(response);
-    char *response_char = get_char_str(response);
+/**
+ * @brief Parse the command line arguments
+ *
+ * Supported arguments:
+ * - stdin: read a single request from stdin and write the response to stdout
+ * - --workers N: number of worker threads (default: SERVER_WORKERS)
+ * - --io-uring: serve the clients with the io_uring event loop instead of epoll
+ *
+ * Exits with error if an argument is unknown or the number of workers is invalid.
+ *
+ * @param argc the number of arguments
+ * @param argv the arguments
+ * @return the parsed options
+ */
+static server_options parse_arguments(int argc, char *argv[]) {
+  server_options options = {.use_stdin = false, .use_io_uring = false, .workers = SERVER_WORKERS};
 
-    // write the outgoing data to the socket
-    length = write(new_sock_fd, response_char, response_len);
+  for (int i = 1; i < argc; i++) {
+    if (strcmp("stdin", argv[i]) == 0) {
+      options.use_stdin = true;
+      continue;
+    }
 
-    if (length < 0) {
-      exit_err("main_loop", "writing to socket");
+    if (strcmp("--io-uring", argv[i]) == 0) {
+      options.use_io_uring = true;
+      continue;
     }
 
-    free_str(response);
+    if (strcmp("--workers", argv[i]) == 0 && i + 1 < argc) {
+      char *end = NULL;
+      options.workers = strtol(argv[++i], &end, 10);
+
+      if (*end != '\0' || options.workers <= 0) {
+        exit_err("parse_arguments", "--workers expects a positive number");
+      }
 
-    // close the connection
-    if (close(new_sock_fd) < 0) {
-      exit_err("main_loop", "on close");
+      continue;
     }
+
+    exit_err("parse_arguments", "usage: server.out [stdin] [--workers N] [--io-uring]");
   }
 
-  free(buffer);
+  // default to one worker per online cpu
+  if (options.workers <= 0) {
+    options.workers = sysconf(_SC_NPROCESSORS_ONLN);
+  }
 
-  if (close(sock_fd) < 0) {
-    exit_err("main_loop", "on close");
+  if (options.workers <= 0) {
+    options.workers = 1;
   }
+
+  return options;
 }
 
 /**
@@ -219,13 +373,19 @@ static void main_loop() {
  * @return the exit status
  */
 int main(int argc, char *argv[]) {
+  server_options options = parse_arguments(argc, argv);
+
   register_signal();
+  open_document_roots();
+  init_error_responses();
 
-  if (argc == 2 && strcmp("stdin", argv[1]) == 0) {
+  if (options.use_stdin) {
     main_loop_stdin();
   } else {
-    main_loop();
+    main_loop(&options);
   }
 
+  close_document_roots();
+
   return 0;
 }
@@ -11,14 +11,26 @@
 #define SERVER_PORT 31337
 
 /**
- * The maximum size of server data buffer.
+ * The maximum number of pending connections waiting to be accepted (listen backlog).
  */
-#define SERVER_BUFFER_SIZE 1024 * 1024
+#define SERVER_MAX_CONNECTIONS 1024
 
 /**
- * The maximum number of connections the server will accept.
+ * The number of worker threads, each with its own listening socket and event loop.
+ * 0 starts one worker per online cpu. Can be overridden with `--workers N`.
  */
-#define SERVER_MAX_CONNECTIONS 5
+#define SERVER_WORKERS 0
+
+/**
+ * Seconds a connection may stay idle (no request received, no response progress) before it is
+ * closed.
+ */
+#define SERVER_KEEP_ALIVE_TIMEOUT 5
+
+/**
+ * Maximum number of requests served on one persistent connection before it is closed.
+ */
+#define SERVER_KEEP_ALIVE_MAX_REQUESTS 100
 
 /**
  * The server signature.
@@ -36,6 +48,41 @@
  */
 #define DOCUMENT_ROOT "src/htdocs"
 
+/**
+ * Memory budget in bytes of the file cache of every worker. Cached files are evicted in least
+ * recently used order once the budget is exceeded.
+ */
+#define FILE_CACHE_SIZE (64 * 1024 * 1024)
+
+/**
+ * Size in bytes of the largest file that is cached, larger files are sent directly from the file.
+ */
+#define FILE_CACHE_MAX_FILE_SIZE (1024 * 1024)
+
+/**
+ * Number of larger files every worker keeps open (least recently used ones are closed), hits are
+ * sent from the open file descriptor without opening the file again.
+ */
+#define FILE_CACHE_MAX_DESCRIPTORS 64
+
+/**
+ * Number of failed lookups (404 and 403) every worker remembers, repeated requests for them are
+ * answered with the prepared error response without touching the file system.
+ */
+#define FILE_CACHE_MAX_NEGATIVES 1024
+
+/**
+ * Seconds a failed lookup is remembered (a file that is created afterwards is served at the latest
+ * once it expired).
+ */
+#define FILE_CACHE_NEGATIVE_TTL 2
+
+/**
+ * Seconds a cached file (or file descriptor) is served without checking whether it changed
+ * (modification time, size or a replaced file) on disk.
+ */
+#define FILE_CACHE_REVALIDATE_INTERVAL 1
+
 /**
  * Maximum size of a request.
  * By default, this is set to 8192 bytes (8KB). (reference:
@@ -52,6 +99,7 @@
  * Route definitions.
  */
 #define ROUTE_DEBUG "/debug"
+#define ROUTE_STATS "/stats"
 #define ROUTE_DEFAULT_HOST "/default"
 #define ROUTE_EXTERN_HOST "/extern"
 #define ROUTE_INTERN_HOST "/intern"
@@ -0,0 +1,39 @@
+#!/bin/bash
+# Measures requests/sec of the server for an increasing number of workers.
+# Usage: ./scripts/benchmark.sh [max workers] [load_benchmark arguments...]
+# Requires a build (cmake . && make) in the project root.
+
+THIS_PATH="$(realpath "$0")"
+THIS_DIR="$(dirname "$THIS_PATH")"
+ROOT_DIR="$THIS_DIR/.."
+
+SERVER="$ROOT_DIR/build/server.out"
+LOAD="$ROOT_DIR/build/load_benchmark.out"
+
+MAX_WORKERS="${1:-$(nproc)}"
+shift
+
+if [ ! -x "$SERVER" ] || [ ! -x "$LOAD" ]; then
+    echo "Error: $SERVER or $LOAD not found, build the project first"
+    exit 1
+fi
+
+# the document root is relative to the project root
+cd "$ROOT_DIR" || exit 1
+
+WORKERS=1
+
+while [ "$WORKERS" -le "$MAX_WORKERS" ]; do
+    "$SERVER" --workers "$WORKERS" &
+    SERVER_PID=$!
+    sleep 1
+
+    echo "workers: $WORKERS"
+    "$LOAD" "$@"
+    echo
+
+    kill -INT "$SERVER_PID"
+    wait "$SERVER_PID"
+
+    WORKERS=$((WORKERS * 2))
+done
@@ -0,0 +1,57 @@
+#!/bin/bash
+# Compares requests/sec, latency and syscalls per request of the epoll and the io_uring backend.
+# Usage: ./scripts/benchmark_backends.sh [load_benchmark arguments...]
+# Requires a build (cmake . && make) in the project root, strace is optional.
+
+THIS_PATH="$(realpath "$0")"
+THIS_DIR="$(dirname "$THIS_PATH")"
+ROOT_DIR="$THIS_DIR/.."
+
+SERVER="$ROOT_DIR/build/server.out"
+LOAD="$ROOT_DIR/build/load_benchmark.out"
+
+if [ ! -x "$SERVER" ] || [ ! -x "$LOAD" ]; then
+    echo "Error: $SERVER or $LOAD not found, build the project first"
+    exit 1
+fi
+
+# the document root is relative to the project root
+cd "$ROOT_DIR" || exit 1
+
+for BACKEND in epoll io_uring; do
+    ARGS=(--workers 1)
+
+    if [ "$BACKEND" = "io_uring" ]; then
+        ARGS+=(--io-uring)
+    fi
+
+    "$SERVER" "${ARGS[@]}" &
+    SERVER_PID=$!
+    sleep 1
+
+    echo "backend: $BACKEND"
+    "$LOAD" "$@"
+
+    # strace slows down the server, so the syscalls are counted in a separate run
+    if command -v strace > /dev/null; then
+        STRACE_LOG="$(mktemp)"
+        strace -c -f -o "$STRACE_LOG" -p "$SERVER_PID" &
+        STRACE_PID=$!
+        sleep 1
+
+        REQUESTS="$("$LOAD" "$@" | sed -n 's/^requests: \([0-9]*\).*/\1/p')"
+
+        kill -INT "$STRACE_PID"
+        wait "$STRACE_PID"
+
+        # columns of the summary: % time, seconds, usecs/call, calls, errors, syscall
+        SYSCALLS="$(awk '$NF == "total" { print $4 }' "$STRACE_LOG")"
+        echo "syscalls/request: $(awk -v s="$SYSCALLS" -v r="$REQUESTS" 'BEGIN { printf "%.2f", r > 0 ? s / r : 0 }')"
+        rm -f "$STRACE_LOG"
+    fi
+
+    echo
+
+    kill -INT "$SERVER_PID"
+    wait "$SERVER_PID"
+done
@@ -0,0 +1,242 @@
+#define _GNU_SOURCE
+
+#include "event_loop.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+/// markers for the events that do not belong to a connection
+static char listen_marker;
+static char wake_marker;
+
+/**
+ * @brief Switch a file descriptor to non-blocking mode
+ *
+ * @param fd The file descriptor
+ * @return EXIT_SUCCESS if the mode was set, EXIT_FAILURE otherwise
+ */
+static int set_non_blocking(int fd) {
+  int flags = fcntl(fd, F_GETFL, 0);
+
+  if (flags < 0 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0) {
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Close a connection and remove it from the list of open connections
+ *
+ * Closing the socket removes it from the epoll instance as well.
+ *
+ * @param connections The list of open connections
+ * @param connection The connection to close
+ */
+static void close_connection(connection_list *connections, connection_t *connection) {
+  unlink_connection(connections, connection);
+  free_connection(&connection);
+}
+
+/**
+ * @brief Close all connections that have been idle for SERVER_KEEP_ALIVE_TIMEOUT seconds
+ *
+ * Only the idle connections at the tail of the list are visited.
+ *
+ * @param connections The list of open connections
+ * @param now The current time
+ */
+static void close_idle_connections(connection_list *connections, time_t now) {
+  connection_t *connection;
+
+  while ((connection = idle_connection(connections, now)) != NULL) {
+    close_connection(connections, connection);
+  }
+}
+
+/**
+ * @brief Reject a pending connection although no file descriptor is left
+ *
+ * The spare file descriptor is closed to accept the connection, which is closed at once. Otherwise
+ * the connection would stay in the backlog and the edge-triggered listener would not report it
+ * again.
+ *
+ * @param sock_fd The listening socket
+ * @param spare_fd The spare file descriptor (reopened afterwards, -1 if that failed)
+ * @return true if a connection has been rejected
+ */
+static bool reject_connection(int sock_fd, int *spare_fd) {
+  if (*spare_fd < 0) {
+    return false;
+  }
+
+  close(*spare_fd);
+  int client_fd = accept4(sock_fd, NULL, NULL, SOCK_CLOEXEC);
+
+  if (client_fd >= 0) {
+    close(client_fd);
+  }
+
+  *spare_fd = open("/dev/null", O_RDONLY | O_CLOEXEC);
+
+  return client_fd >= 0;
+}
+
+/**
+ * @brief Accept all pending connections of the listening socket
+ *
+ * Accepts until the listening socket would block. Each client socket is registered for read and
+ * write readiness (edge-triggered) and linked into the list of open connections. Connections that
+ * can not get a file descriptor (EMFILE, ENFILE) are rejected with the spare file descriptor.
+ *
+ * @param epoll_fd The epoll instance
+ * @param sock_fd The listening socket
+ * @param spare_fd File descriptor that is given up to reject a connection
+ * @param connections The list of open connections
+ * @param pool The buffer pool of the receive buffers
+ * @param now The current time
+ * @return true if all pending connections have been accepted, false if accepting failed (it has to
+ * be retried, the listener does not report the pending connections again)
+ */
+static bool accept_connections(int epoll_fd, int sock_fd, int *spare_fd,
+                               connection_list *connections, buffer_pool *pool, time_t now) {
+  while (true) {
+    int client_fd = accept4(sock_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+
+    if (client_fd < 0) {
+      int error = errno;
+
+      if (error == EINTR || error == ECONNABORTED) {
+        continue;
+      }
+
+      if ((error == EMFILE || error == ENFILE) && reject_connection(sock_fd, spare_fd)) {
+        continue;
+      }
+
+      // EAGAIN: no more pending connections, anything else (e.g. ENOMEM) is retried
+      return error == EAGAIN || error == EWOULDBLOCK;
+    }
+
+    connection_t *connection = new_connection(client_fd, pool);
+
+    if (connection == NULL) {
+      close(client_fd);
+      continue;
+    }
+
+    struct epoll_event event;
+    event.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+    event.data.ptr = connection;
+
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, client_fd, &event) < 0) {
+      free_connection(&connection);
+      continue;
+    }
+
+    connection->last_active = now;
+    link_connection(connections, connection);
+  }
+}
+
+void event_loop(int sock_fd, int wake_fd, request_handler handler, atomic_bool *run) {
+  connection_list connections = {.head = NULL, .tail = NULL};
+  struct epoll_event events[EVENT_LOOP_MAX_EVENTS];
+  buffer_pool *pool = new_buffer_pool();
+
+  if (pool == NULL) {
+    exit_err("event_loop", "at calloc.");
+  }
+
+  if (set_non_blocking(sock_fd) == EXIT_FAILURE) {
+    exit_err("event_loop", "on fcntl");
+  }
+
+  const int epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+
+  if (epoll_fd < 0) {
+    exit_err("event_loop", "on epoll_create1");
+  }
+
+  struct epoll_event listen_event;
+  listen_event.events = EPOLLIN | EPOLLET;
+  listen_event.data.ptr = &listen_marker;
+
+  if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, sock_fd, &listen_event) < 0) {
+    exit_err("event_loop", "on epoll_ctl");
+  }
+
+  // reserved to reject connections once all file descriptors are in use
+  int spare_fd = open("/dev/null", O_RDONLY | O_CLOEXEC);
+  // accepting failed, the pending connections are not reported again by the listener
+  bool accept_pending = false;
+
+  // level-triggered and never read: once signaled, every loop sharing wake_fd wakes up
+  struct epoll_event wake_event;
+  wake_event.events = EPOLLIN;
+  wake_event.data.ptr = &wake_marker;
+
+  if (wake_fd >= 0 && epoll_ctl(epoll_fd, EPOLL_CTL_ADD, wake_fd, &wake_event) < 0) {
+    exit_err("event_loop", "on epoll_ctl");
+  }
+
+  while (*run) {
+    int count = epoll_wait(epoll_fd, events, EVENT_LOOP_MAX_EVENTS, EVENT_LOOP_TIMEOUT_MS);
+
+    if (count < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+
+      exit_err("event_loop", "on epoll_wait");
+    }
+
+    time_t now = monotonic_seconds();
+
+    for (int i = 0; i < count; i++) {
+      if (events[i].data.ptr == &wake_marker) {
+        continue;
+      }
+
+      if (events[i].data.ptr == &listen_marker) {
+        accept_pending = !accept_connections(epoll_fd, sock_fd, &spare_fd, &connections, pool, now);
+        continue;
+      }
+
+      connection_t *connection = events[i].data.ptr;
+
+      if (events[i].events & EPOLLERR) {
+        close_connection(&connections, connection);
+        continue;
+      }
+
+      if (handle_connection(connection, handler) == CONNECTION_CLOSED) {
+        close_connection(&connections, connection);
+        continue;
+      }
+
+      touch_connection(&connections, connection, now);
+    }
+
+    close_idle_connections(&connections, now);
+
+    // retried at the latest after EVENT_LOOP_TIMEOUT_MS
+    if (accept_pending) {
+      accept_pending = !accept_connections(epoll_fd, sock_fd, &spare_fd, &connections, pool, now);
+    }
+  }
+
+  // close all connections that are still open
+  while (connections.head != NULL) {
+    close_connection(&connections, connections.head);
+  }
+
+  if (spare_fd >= 0) {
+    close(spare_fd);
+  }
+
+  close(epoll_fd);
+  free_buffer_pool(&pool);
+}
@@ -0,0 +1,39 @@
+#ifndef EVENT_LOOP_H
+#define EVENT_LOOP_H
+
+#include "../http_connection/http_connection.h"
+#include <stdatomic.h>
+#include <stdbool.h>
+
+/**
+ * Maximum number of events handled per epoll_wait() call.
+ */
+#define EVENT_LOOP_MAX_EVENTS 1024
+
+/**
+ * Maximum time in milliseconds epoll_wait() blocks before idle connections are checked.
+ */
+#define EVENT_LOOP_TIMEOUT_MS 1000
+
+/**
+ * @brief Run the epoll event loop for a listening socket
+ * @warning The listening socket will be switched to non-blocking mode
+ *
+ * All sockets are registered edge-triggered. New connections are accepted in batches until the
+ * listening socket would block, every connection keeps its own read/write state so a slow client
+ * does not block the others. The loop runs until run is set to false, remaining connections are
+ * closed afterwards. Several loops (one per worker thread) can share the same run flag and wake_fd.
+ * Connections without activity for SERVER_KEEP_ALIVE_TIMEOUT seconds are closed. Once all file
+ * descriptors are in use, new connections are closed right after they have been accepted.
+ *
+ * Exits with error if the epoll instance could not be created or waited on.
+ *
+ * @param sock_fd The listening socket
+ * @param wake_fd File descriptor that becomes readable once the loop should check run (e.g. an
+ * eventfd), -1 to only rely on EINTR
+ * @param handler The handler that turns a raw request into an encoded response
+ * @param run Flag that stops the loop once it is false
+ */
+void event_loop(int sock_fd, int wake_fd, request_handler handler, atomic_bool *run);
+
+#endif
@@ -0,0 +1,406 @@
+#include "http_connection.h"
+#include "../../main.h"
+#include <errno.h>
+#include <sys/sendfile.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+connection_t *new_connection(int fd, buffer_pool *pool) {
+  connection_t *connection = calloc(1, sizeof(struct connection_t));
+
+  if (connection == NULL) {
+    return NULL;
+  }
+
+  connection->fd = fd;
+  connection->state = CONNECTION_READING;
+  connection->in = NULL;
+  connection->pool = pool;
+  reset_request_parser(&connection->parser);
+  init_arena(&connection->arena, pool);
+  connection->out = NULL;
+  connection->out_tail = NULL;
+  connection->out_offset = 0;
+  connection->keep_alive = false;
+  connection->peer_closed = false;
+  connection->requests = 0;
+  connection->pipe_fds[0] = -1;
+  connection->pipe_fds[1] = -1;
+  connection->pipe_pending = 0;
+
+  return connection;
+}
+
+void free_connection(connection_t **connection) {
+  if (*connection == NULL) {
+    return;
+  }
+
+  close((*connection)->fd);
+
+  for (size_t i = 0; i < 2; i++) {
+    if ((*connection)->pipe_fds[i] >= 0) {
+      close((*connection)->pipe_fds[i]);
+    }
+  }
+
+  release_buffer((*connection)->pool, &(*connection)->in);
+  while ((*connection)->out != NULL) {
+    encoded_response_t *response = (*connection)->out;
+    (*connection)->out = response->next;
+    free_encoded_response(&response);
+  }
+
+  release_arena(&(*connection)->arena);
+  free(*connection);
+  *connection = NULL;
+}
+
+time_t monotonic_seconds() {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC_COARSE, &now);
+
+  return now.tv_sec;
+}
+
+void link_connection(connection_list *connections, connection_t *connection) {
+  connection->prev = NULL;
+  connection->next = connections->head;
+
+  if (connections->head != NULL) {
+    connections->head->prev = connection;
+  } else {
+    connections->tail = connection;
+  }
+
+  connections->head = connection;
+}
+
+void unlink_connection(connection_list *connections, connection_t *connection) {
+  if (connection->prev != NULL) {
+    connection->prev->next = connection->next;
+  } else {
+    connections->head = connection->next;
+  }
+
+  if (connection->next != NULL) {
+    connection->next->prev = connection->prev;
+  } else {
+    connections->tail = connection->prev;
+  }
+
+  connection->prev = NULL;
+  connection->next = NULL;
+}
+
+void touch_connection(connection_list *connections, connection_t *connection, time_t now) {
+  connection->last_active = now;
+
+  if (connections->head == connection) {
+    return;
+  }
+
+  unlink_connection(connections, connection);
+  link_connection(connections, connection);
+}
+
+connection_t *idle_connection(connection_list *connections, time_t now) {
+  connection_t *oldest = connections->tail;
+
+  if (oldest == NULL || now - oldest->last_active < SERVER_KEEP_ALIVE_TIMEOUT) {
+    return NULL;
+  }
+
+  return oldest;
+}
+
+connection_state connection_read(connection_t *connection) {
+  while (true) {
+    if (connection->in == NULL || connection->in->length == connection->in->capacity) {
+      // complete requests are processed before more data is read
+      if (connection->parser.status == REQUEST_PARSE_COMPLETE) {
+        break;
+      }
+
+      size_t capacity =
+          connection->in == NULL ? CONNECTION_BUFFER_SIZE : connection->in->capacity * 2;
+
+      if (!grow_buffer(connection->pool, &connection->in, capacity)) {
+        return CONNECTION_CLOSED;
+      }
+    }
+
+    buffer_t *in = connection->in;
+    ssize_t length = read(connection->fd, in->data + in->length, in->capacity - in->length);
+
+    if (length > 0) {
+      in->length += length;
+
+      // an oversized request head is rejected without reading the rest of it
+      if (parse_request_incremental(&connection->parser, in->data, in->length) ==
+          REQUEST_PARSE_ERROR) {
+        break;
+      }
+
+      continue;
+    }
+
+    // the client closed the connection (a half-closed connection still gets its response)
+    if (length == 0) {
+      connection->peer_closed = true;
+      break;
+    }
+
+    if (errno == EINTR) {
+      continue;
+    }
+
+    // everything that was available has been read
+    if (errno == EAGAIN || errno == EWOULDBLOCK) {
+      break;
+    }
+
+    return CONNECTION_CLOSED;
+  }
+
+  // idle connections do not hold a buffer
+  if (connection->in != NULL && connection->in->length == 0) {
+    release_buffer(connection->pool, &connection->in);
+  }
+
+  if (connection->peer_closed && connection->in == NULL) {
+    return CONNECTION_CLOSED;
+  }
+
+  return CONNECTION_READING;
+}
+
+struct msghdr *connection_output(connection_t *connection) {
+  size_t count = 0;
+  size_t skip = connection->out_offset;
+
+  for (encoded_response_t *response = connection->out;
+       response != NULL && count < CONNECTION_MAX_SEGMENTS; response = response->next) {
+    string *segments[] = {response->head, response->body,
+                          response->cached == NULL ? NULL : response->cached->content};
+
+    for (size_t i = 0; i < 3 && count < CONNECTION_MAX_SEGMENTS; i++) {
+      size_t length = segments[i] == NULL ? 0 : get_length(segments[i]);
+
+      // already sent
+      if (skip >= length) {
+        skip -= length;
+        continue;
+      }
+
+      connection->out_segments[count].iov_base = segments[i]->str + skip;
+      connection->out_segments[count].iov_len = length - skip;
+      skip = 0;
+      count++;
+    }
+
+    // the file body has to be sent before anything of the following responses
+    if (skip < response->file_length) {
+      break;
+    }
+
+    skip -= response->file_length;
+  }
+
+  memset(&connection->out_message, 0, sizeof(struct msghdr));
+  connection->out_message.msg_iov = connection->out_segments;
+  connection->out_message.msg_iovlen = count;
+
+  return &connection->out_message;
+}
+
+int connection_output_file(connection_t *connection, off_t *offset, size_t *length) {
+  encoded_response_t *response = connection->out;
+
+  // only the first queued response can be partially sent
+  if (response == NULL || response->file_fd < 0) {
+    return -1;
+  }
+
+  size_t buffered = get_encoded_response_length(response) - response->file_length;
+
+  if (connection->out_offset < buffered) {
+    return -1;
+  }
+
+  *offset = response->file_offset + (off_t)(connection->out_offset - buffered);
+  *length = response->file_length - (connection->out_offset - buffered);
+
+  return response->file_fd;
+}
+
+connection_state connection_sent(connection_t *connection, size_t length) {
+  connection->out_offset += length;
+
+  // free the responses that have been sent completely
+  while (connection->out != NULL &&
+         connection->out_offset >= get_encoded_response_length(connection->out)) {
+    encoded_response_t *sent = connection->out;
+
+    connection->out_offset -= get_encoded_response_length(sent);
+    connection->out = sent->next;
+    free_encoded_response(&sent);
+  }
+
+  if (connection->out != NULL) {
+    return CONNECTION_WRITING;
+  }
+
+  connection->out_tail = NULL;
+  connection->out_offset = 0;
+
+  // the blocks go back to the pool and are reused by the next request
+  release_arena(&connection->arena);
+
+  return connection->keep_alive ? CONNECTION_READING : CONNECTION_CLOSED;
+}
+
+connection_state connection_write(connection_t *connection) {
+  connection_state state = CONNECTION_WRITING;
+
+  while (state == CONNECTION_WRITING) {
+    off_t file_offset = 0;
+    size_t file_length = 0;
+    int file_fd = connection_output_file(connection, &file_offset, &file_length);
+    ssize_t length;
+
+    if (file_fd >= 0) {
+      // the kernel copies the file directly to the socket
+      length = sendfile(connection->fd, file_fd, &file_offset, file_length);
+
+      // the file has been truncated, the announced content length can not be sent anymore
+      if (length == 0) {
+        return CONNECTION_CLOSED;
+      }
+    } else {
+      // MSG_NOSIGNAL: a client that went away must not kill the server with SIGPIPE
+      length = sendmsg(connection->fd, connection_output(connection), MSG_NOSIGNAL);
+    }
+
+    if (length >= 0) {
+      state = connection_sent(connection, length);
+      continue;
+    }
+
+    if (errno == EINTR) {
+      continue;
+    }
+
+    // the socket buffer is full, continue once the socket becomes writable again
+    if (errno == EAGAIN || errno == EWOULDBLOCK) {
+      return CONNECTION_WRITING;
+    }
+
+    return CONNECTION_CLOSED;
+  }
+
+  return state;
+}
+
+size_t process_connection(connection_t *connection, request_handler handler) {
+  string received = buffer_string(connection->in);
+  request_parser *parser = &connection->parser;
+  size_t offset = 0;
+  size_t processed = 0;
+
+  if (received.len == 0) {
+    return 0;
+  }
+
+  // continues after the bytes that have been parsed before
+  request_parse_status status = parse_request_incremental(parser, received.str, received.len);
+
+  while (offset < received.len) {
+    // wait for the rest of an incomplete request head
+    if (status == REQUEST_PARSE_INCOMPLETE && !connection->peer_closed) {
+      break;
+    }
+
+    // the rest will never arrive or the head is too large (rejected by the handler)
+    size_t request_len = status == REQUEST_PARSE_COMPLETE ? parser->length : received.len - offset;
+
+    // the parser moves on to the next request
+    reset_request_parser(parser);
+    status = parse_request_incremental(parser, received.str + offset + request_len,
+                                       received.len - offset - request_len);
+
+    // a half-closed connection is closed after the last request it sent
+    connection->requests++;
+    connection->keep_alive = connection->requests < SERVER_KEEP_ALIVE_MAX_REQUESTS &&
+                             (!connection->peer_closed || status == REQUEST_PARSE_COMPLETE);
+
+    // the handler works directly on the receive buffer, the request is null terminated in place
+    // for the call (the first byte of the next request is restored afterwards)
+    string request = {.len = request_len, .str = received.str + offset};
+    char next = request.str[request.len];
+    request.str[request.len] = '\0';
+
+    encoded_response_t *response = handler(&request, &connection->keep_alive, &connection->arena);
+    request.str[request.len] = next;
+
+    offset += request_len;
+    processed++;
+
+    if (response == NULL) {
+      connection->keep_alive = false;
+    } else if (connection->out == NULL) {
+      connection->out = response;
+      connection->out_tail = response;
+    } else {
+      connection->out_tail->next = response;
+      connection->out_tail = response;
+    }
+
+    // requests after a response that closes the connection are dropped
+    if (!connection->keep_alive) {
+      offset = received.len;
+      reset_request_parser(parser);
+      break;
+    }
+  }
+
+  // keep the incomplete rest at the start of the buffer
+  buffer_consume(connection->in, offset);
+
+  if (connection->in->length == 0) {
+    release_buffer(connection->pool, &connection->in);
+  }
+
+  return processed;
+}
+
+connection_state handle_connection(connection_t *connection, request_handler handler) {
+  while (true) {
+    if (connection->state == CONNECTION_READING) {
+      if (!connection->peer_closed) {
+        connection->state = connection_read(connection);
+      }
+
+      if (connection->state != CONNECTION_READING) {
+        return connection->state;
+      }
+
+      // nothing to process yet
+      if (connection->in == NULL || process_connection(connection, handler) == 0) {
+        connection->state = connection->peer_closed ? CONNECTION_CLOSED : CONNECTION_READING;
+        return connection->state;
+      }
+
+      connection->state = CONNECTION_WRITING;
+    }
+
+    // all queued responses are written at once
+    connection->state = connection_write(connection);
+
+    // the socket would block or the connection is done, otherwise continue with the next request
+    // (data that arrived while writing does not trigger another edge)
+    if (connection->state != CONNECTION_READING) {
+      return connection->state;
+    }
+  }
+}
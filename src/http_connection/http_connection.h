@@ -0,0 +1,260 @@
+#ifndef HTTP_CONNECTION_H
+#define HTTP_CONNECTION_H
+
+#include "../../lib/arena/arena.h"
+#include "../../lib/buffer_pool/buffer_pool.h"
+#include "../../lib/string_lib/string_lib.h"
+#include "../http_models/http_models.h"
+#include "../http_parser/http_parser.h"
+#include <stdbool.h>
+#include <sys/socket.h>
+#include <time.h>
+
+/**
+ * Initial capacity of the receive buffer of a connection, the buffer grows if a request head does
+ * not fit.
+ */
+#define CONNECTION_BUFFER_SIZE BUFFER_POOL_MIN_SIZE
+
+/**
+ * Maximum number of segments (heads and bodies of queued responses) sent with one scatter-gather
+ * write.
+ */
+#define CONNECTION_MAX_SEGMENTS 16
+
+/**
+ * @brief Request handler used by a connection
+ * @warning The request string points into the receive buffer of the connection, it is only valid
+ * during the call and must not be freed (it may be modified in place)
+ *
+ * Receives the raw request and returns the encoded response that will be written to the client
+ * (the connection takes ownership of it).
+ * keep_alive is true if the connection may stay open after the response, the handler sets it to
+ * whether the connection stays open.
+ * Memory of the response can be allocated from the arena of the connection, it is released at once
+ * after all queued responses have been sent.
+ */
+typedef encoded_response_t *(*request_handler)(string *request, bool *keep_alive, arena *arena);
+
+enum connection_state {
+  CONNECTION_READING,
+  CONNECTION_WRITING,
+  CONNECTION_CLOSED
+} typedef connection_state;
+
+struct connection_t {
+  int fd;
+  connection_state state;
+  // receive buffer from the pool, NULL while nothing has been received
+  buffer_t *in;
+  buffer_pool *pool;
+  // parser of the request at the start of the receive buffer, it continues where it stopped
+  request_parser parser;
+  // memory of the queued responses, released once all of them have been sent
+  arena arena;
+  // queued responses, the first one has been sent up to out_offset
+  encoded_response_t *out;
+  encoded_response_t *out_tail;
+  size_t out_offset;
+  // segments of the queued responses for the next scatter-gather write
+  struct iovec out_segments[CONNECTION_MAX_SEGMENTS];
+  struct msghdr out_message;
+  bool keep_alive;
+  bool peer_closed;
+  size_t requests;
+  time_t last_active;
+  // io_uring backend: number of submitted operations and whether a multishot recv is armed
+  unsigned inflight;
+  bool recv_armed;
+  // io_uring backend: pipe a file body is spliced through (-1 until it is needed) and the number of
+  // bytes in it that still have to be sent
+  int pipe_fds[2];
+  size_t pipe_pending;
+  struct connection_t *prev;
+  struct connection_t *next;
+} typedef connection_t;
+
+/**
+ * List of open connections, ordered by their last activity (most recent first).
+ */
+struct connection_list {
+  connection_t *head;
+  connection_t *tail;
+} typedef connection_list;
+
+/**
+ * @brief Create a new connection object for a connected socket
+ * @warning The socket has to be non-blocking
+ *
+ * Returns NULL if memory allocation fails.
+ *
+ * @param fd The socket file descriptor of the client
+ * @param pool The buffer pool the receive buffer is taken from
+ * @return Created connection object
+ */
+connection_t *new_connection(int fd, buffer_pool *pool);
+
+/**
+ * @brief Free the memory allocated for a connection object and close its socket
+ * @warning This function will check if the given pointer is NULL
+ *
+ * Returns if the connection object is NULL.
+ *
+ * @param connection Connection object to be freed
+ */
+void free_connection(connection_t **connection);
+
+/**
+ * @brief Get the current time of the monotonic clock in seconds
+ *
+ * Used for the last activity of connections.
+ *
+ * @return the current time
+ */
+time_t monotonic_seconds();
+
+/**
+ * @brief Insert a connection at the head (most recently active end) of a list
+ *
+ * @param connections The list of connections
+ * @param connection The connection to insert
+ */
+void link_connection(connection_list *connections, connection_t *connection);
+
+/**
+ * @brief Remove a connection from a list
+ *
+ * @param connections The list of connections
+ * @param connection The connection to remove
+ */
+void unlink_connection(connection_list *connections, connection_t *connection);
+
+/**
+ * @brief Mark a connection as active
+ *
+ * Moves the connection to the head of the list, so the list stays ordered by the last activity and
+ * idle connections can be found at the tail.
+ *
+ * @param connections The list of connections
+ * @param connection The active connection
+ * @param now The current time (monotonic seconds)
+ */
+void touch_connection(connection_list *connections, connection_t *connection, time_t now);
+
+/**
+ * @brief Get the least recently active connection if it has been idle for too long
+ *
+ * Returns NULL if no connection has been idle for SERVER_KEEP_ALIVE_TIMEOUT seconds.
+ *
+ * @param connections The list of connections
+ * @param now The current time (monotonic seconds)
+ * @return The idle connection (still linked)
+ */
+connection_t *idle_connection(connection_list *connections, time_t now);
+
+/**
+ * @brief Read all available data from the socket
+ *
+ * Reads until the socket would block (EAGAIN). The data is read directly into connection->in,
+ * which is taken from the buffer pool and only grown while the first request head does not fit.
+ * The received bytes are fed to connection->parser, so every byte is only scanned once. Reading
+ * stops early once the buffer is full and holds a complete request head or the first request head
+ * exceeds HTTP_MAX_REQUEST_SIZE bytes without being complete. An empty buffer is returned to the
+ * pool. If the client closed its side of the connection, connection->peer_closed is set.
+ *
+ * Returns CONNECTION_CLOSED if the client closed the connection without sending data or if an
+ * error occurred, CONNECTION_READING otherwise.
+ *
+ * @param connection The connection to read from
+ * @return The new state of the connection
+ */
+connection_state connection_read(connection_t *connection);
+
+/**
+ * @brief Process all complete requests in the receive buffer
+ *
+ * Pipelined requests are passed to the handler in order (without copying them out of the receive
+ * buffer) and their responses are queued in connection->out, so they can be written together. An
+ * incomplete request at the end of the buffer is kept until the rest has been received, the state
+ * of connection->parser is kept as well (the next call only parses the new bytes). Only if
+ * the client closed its side or the incomplete head exceeds HTTP_MAX_REQUEST_SIZE bytes, the
+ * incomplete rest is processed as it is (and rejected by the handler). Connections are not kept
+ * alive after SERVER_KEEP_ALIVE_MAX_REQUESTS requests.
+ *
+ * @param connection The connection with received data in connection->in
+ * @param handler The handler that turns a raw request into an encoded response
+ * @return The number of processed requests (0 if nothing has been queued)
+ */
+size_t process_connection(connection_t *connection, request_handler handler);
+
+/**
+ * @brief Prepare the queued responses for a scatter-gather write
+ *
+ * Fills connection->out_message with up to CONNECTION_MAX_SEGMENTS segments (the unsent parts of
+ * the heads and bodies of the queued responses), the data is not copied. The message stays valid
+ * until connection_sent() is called. The segments end before the first file body, the message is
+ * empty if a file body has to be sent next (see connection_output_file()).
+ *
+ * @param connection The connection with queued responses
+ * @return The message to be passed to sendmsg()
+ */
+struct msghdr *connection_output(connection_t *connection);
+
+/**
+ * @brief Get the file body that has to be sent next
+ *
+ * Returns -1 if the next unsent byte of the queued responses is not part of a file body.
+ *
+ * @param connection The connection with queued responses
+ * @param offset Set to the offset of the unsent part in the file
+ * @param length Set to the number of unsent bytes of the file body
+ * @return The file descriptor of the file
+ */
+int connection_output_file(connection_t *connection, off_t *offset, size_t *length);
+
+/**
+ * @brief Account for bytes of the queued responses that have been sent
+ *
+ * Responses that have been sent completely are freed. Returns CONNECTION_WRITING if a part of the
+ * queued responses is still pending, CONNECTION_READING once all of them were sent and the
+ * connection is kept alive, CONNECTION_CLOSED otherwise.
+ *
+ * @param connection The connection that sent data
+ * @param length The number of bytes sent
+ * @return The new state of the connection
+ */
+connection_state connection_sent(connection_t *connection, size_t length);
+
+/**
+ * @brief Write the queued responses to the socket
+ *
+ * Heads and bodies are written with scatter-gather writes (sendmsg()) and file bodies are sent with
+ * sendfile() without copying them to user space, until all responses have been sent or the socket
+ * would block (EAGAIN). Partial writes are tracked in connection->out_offset and resumed on the
+ * next call.
+ *
+ * Returns CONNECTION_WRITING if the socket would block, CONNECTION_READING once the responses were
+ * written completely and the connection is kept alive, CONNECTION_CLOSED once the responses were
+ * written completely otherwise or if an error occurred.
+ *
+ * @param connection The connection to write to
+ * @return The new state of the connection
+ */
+connection_state connection_write(connection_t *connection);
+
+/**
+ * @brief Handle a readiness notification of a connection
+ *
+ * Reads the available request data, passes every complete request to the handler and writes the
+ * responses of pipelined requests together. A connection that is still waiting for the socket to
+ * become writable resumes writing instead. Persistent connections continue with the next request
+ * once the response has been written, the connection is closed after
+ * SERVER_KEEP_ALIVE_MAX_REQUESTS requests.
+ *
+ * @param connection The connection that became ready
+ * @param handler The handler that turns a raw request into an encoded response
+ * @return The new state of the connection
+ */
+connection_state handle_connection(connection_t *connection, request_handler handler);
+
+#endif
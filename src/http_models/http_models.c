@@ -1,6 +1,8 @@
 #include "http_models.h"
+#include "../../lib/arena/arena.h"
 #include "../../main.h"
 #include "../http_server/http_server.h"
+#include <unistd.h>
 
 request_t *new_request() {
   request_t *request = calloc(1, sizeof(struct request_t));
@@ -40,11 +42,12 @@ response_t *new_response() {
   response->content_type = _new_string();
   response->content_length = _new_string();
   response->server = _new_string();
+  response->connection = _new_string();
   response->body = _new_string();
 
   if (response->version == NULL || response->status_code == NULL ||
       response->content_type == NULL || response->content_length == NULL ||
-      response->body == NULL || response->server == NULL) {
+      response->body == NULL || response->server == NULL || response->connection == NULL) {
     free(response);
     return NULL;
   }
@@ -52,6 +55,53 @@ response_t *new_response() {
   return response;
 }
 
+encoded_response_t *new_encoded_response() {
+  encoded_response_t *response = calloc(1, sizeof(struct encoded_response_t));
+
+  if (response == NULL) {
+    return NULL;
+  }
+
+  response->head = _new_string();
+  response->body = NULL;
+  response->cached = NULL;
+  response->file_fd = -1;
+  response->file_offset = 0;
+  response->file_length = 0;
+  response->in_arena = false;
+  response->next = NULL;
+
+  if (response->head == NULL) {
+    free(response);
+    return NULL;
+  }
+
+  return response;
+}
+
+encoded_response_t *new_encoded_response_arena(arena *arena) {
+  if (arena == NULL) {
+    return new_encoded_response();
+  }
+
+  encoded_response_t *response = arena_alloc(arena, sizeof(struct encoded_response_t));
+
+  if (response == NULL) {
+    return NULL;
+  }
+
+  response->head = new_string_arena(arena);
+  response->body = NULL;
+  response->cached = NULL;
+  response->file_fd = -1;
+  response->file_offset = 0;
+  response->file_length = 0;
+  response->in_arena = true;
+  response->next = NULL;
+
+  return response;
+}
+
 void free_request(request_t **request) {
   if (*request == NULL) {
     return;
@@ -79,20 +129,77 @@ void free_response(response_t **response) {
   free_str((*response)->content_type);
   free_str((*response)->content_length);
   free_str((*response)->server);
+  free_str((*response)->connection);
   free_str((*response)->body);
   free(*response);
   *response = NULL;
 }
 
+void free_encoded_response(encoded_response_t **response) {
+  if (*response == NULL) {
+    return;
+  }
+
+  // the file descriptor of a cache entry is closed by the cache
+  if ((*response)->file_fd >= 0 && (*response)->cached == NULL) {
+    close((*response)->file_fd);
+  }
+
+  release_file_cache_entry(&(*response)->cached);
+
+  if (!(*response)->in_arena) {
+    free_str((*response)->head);
+    free_str((*response)->body);
+    free(*response);
+  }
+
+  *response = NULL;
+}
+
+size_t get_encoded_response_length(encoded_response_t *response) {
+  size_t length = get_length(response->head);
+
+  if (response->body != NULL) {
+    length += get_length(response->body);
+  }
+
+  if (response->cached != NULL && response->cached->content != NULL) {
+    length += get_length(response->cached->content);
+  }
+
+  return length + response->file_length;
+}
+
 void update_response_content_length(response_t *response) {
   if (response == NULL) {
     return;
   }
 
-  string *content_length = size_t_to_string(get_length(response->body));
-  response->content_length =
-      str_set(response->content_length, get_char_str(content_length), get_length(content_length));
-  free_str(content_length);
+  set_response_content_length(response, get_length(response->body));
+}
+
+void set_response_content_length(response_t *response, size_t length) {
+  if (response == NULL) {
+    return;
+  }
+
+  // formatted on the stack, the string of the response keeps short values inline
+  char digits[24];
+  int digits_length = snprintf(digits, sizeof(digits), "%zu", length);
+  response->content_length = str_set(response->content_length, digits, digits_length);
+}
+
+void update_response_connection(response_t *response, bool keep_alive) {
+  if (response == NULL) {
+    return;
+  }
+
+  // the constants are borrowed, not copied
+  if (keep_alive) {
+    str_borrow(response->connection, CONNECTION_KEEP_ALIVE, STR_LITERAL_LEN(CONNECTION_KEEP_ALIVE));
+  } else {
+    str_borrow(response->connection, CONNECTION_CLOSE, STR_LITERAL_LEN(CONNECTION_CLOSE));
+  }
 }
 
 void generate_response_status(response_t *response, int status_code, string *content_type) {
@@ -100,20 +207,18 @@ void generate_response_status(response_t *response, int status_code, string *con
     return;
   }
 
-  string *status_code_str = int_to_string(status_code);
+  char status_code_str[16];
+  int status_code_length = snprintf(status_code_str, sizeof(status_code_str), "%d", status_code);
   const char *status_message = get_http_status_message(status_code);
 
-  response->version =
-      str_set(response->version, HTTP_DEFAULT_VERSION, strlen(HTTP_DEFAULT_VERSION));
-  response->status_code =
-      str_set(response->status_code, get_char_str(status_code_str), get_length(status_code_str));
-  response->status_message =
-      str_set(response->status_message, status_message, strlen(status_message));
+  // the constants are borrowed, not copied
+  str_borrow(response->version, HTTP_DEFAULT_VERSION, STR_LITERAL_LEN(HTTP_DEFAULT_VERSION));
+  response->status_code = str_set(response->status_code, status_code_str, status_code_length);
+  /// @node strlen() is safe here - status_message is a constant defined in http_server.h
+  str_borrow(response->status_message, status_message, strlen(status_message));
   response->content_type =
       str_set(response->content_type, get_char_str(content_type), get_length(content_type));
-  response->server = str_set(response->server, SERVER_SIGNATURE, strlen(SERVER_SIGNATURE));
-
-  free_str(status_code_str);
+  str_borrow(response->server, SERVER_SIGNATURE, STR_LITERAL_LEN(SERVER_SIGNATURE));
 }
 
 void add_response_string_header(string *raw_string, const char *header, string *value) {
@@ -1,8 +1,102 @@
 #ifndef HTTP_MODELS_H
 #define HTTP_MODELS_H
 
+#include "../../lib/file_lib/file_lib.h"
 #include "../../lib/string_lib/string_lib.h"
+#include <stdbool.h>
+#include <sys/types.h>
 
+enum request_method {
+  REQUEST_METHOD_UNKNOWN,
+  REQUEST_METHOD_GET,
+  REQUEST_METHOD_HEAD,
+  REQUEST_METHOD_POST,
+  REQUEST_METHOD_PUT,
+  REQUEST_METHOD_DELETE,
+  REQUEST_METHOD_CONNECT,
+  REQUEST_METHOD_OPTIONS,
+  REQUEST_METHOD_TRACE,
+  REQUEST_METHOD_PATCH
+} typedef request_method;
+
+enum request_version {
+  REQUEST_VERSION_UNKNOWN,
+  REQUEST_VERSION_1_0,
+  REQUEST_VERSION_1_1
+} typedef request_version;
+
+/**
+ * Request headers with a known name, REQUEST_HEADER_UNKNOWN for all other names.
+ */
+enum request_header {
+  REQUEST_HEADER_UNKNOWN,
+  REQUEST_HEADER_ACCEPT,
+  REQUEST_HEADER_ACCEPT_ENCODING,
+  REQUEST_HEADER_ACCEPT_LANGUAGE,
+  REQUEST_HEADER_AUTHORIZATION,
+  REQUEST_HEADER_CACHE_CONTROL,
+  REQUEST_HEADER_CONNECTION,
+  REQUEST_HEADER_CONTENT_LENGTH,
+  REQUEST_HEADER_CONTENT_TYPE,
+  REQUEST_HEADER_COOKIE,
+  REQUEST_HEADER_EXPECT,
+  REQUEST_HEADER_HOST,
+  REQUEST_HEADER_IF_MATCH,
+  REQUEST_HEADER_IF_MODIFIED_SINCE,
+  REQUEST_HEADER_IF_NONE_MATCH,
+  REQUEST_HEADER_IF_RANGE,
+  REQUEST_HEADER_IF_UNMODIFIED_SINCE,
+  REQUEST_HEADER_ORIGIN,
+  REQUEST_HEADER_RANGE,
+  REQUEST_HEADER_REFERER,
+  REQUEST_HEADER_TE,
+  REQUEST_HEADER_TRANSFER_ENCODING,
+  REQUEST_HEADER_UPGRADE,
+  REQUEST_HEADER_USER_AGENT,
+  REQUEST_HEADER_COUNT
+} typedef request_header;
+
+/**
+ * Maximum number of header lines of a request view.
+ */
+#define REQUEST_MAX_HEADERS 100
+
+/**
+ * Header line of a request view, the value is trimmed.
+ */
+struct request_header_field {
+  request_header id;
+  str_view name;
+  str_view value;
+} typedef request_header_field;
+
+/**
+ * Request parsed in place: the fields are views into the raw request (nothing is copied or
+ * allocated), so the request is only valid as long as the raw request. Fields that are not part
+ * of the request are empty.
+ *
+ * All header lines are kept in the order of the request. header_index maps every known header to
+ * its first occurrence (position in headers + 1, 0 if the request does not contain the header), see
+ * get_request_header(). header_overflow is set if the request has more than REQUEST_MAX_HEADERS
+ * header lines, the rest of them is not kept.
+ */
+struct request_view {
+  str_view method;
+  str_view resource;
+  str_view version;
+  request_header_field headers[REQUEST_MAX_HEADERS];
+  size_t header_count;
+  unsigned char header_index[REQUEST_HEADER_COUNT];
+  bool header_overflow;
+  request_method method_id;
+  request_version version_id;
+  bool keep_alive;
+} typedef request_view;
+
+/**
+ * Request with copies of its fields.
+ * @note Compatibility layer, the server works on request_view
+ */
 struct request_t {
   string *method;
   string *resource;
@@ -11,6 +105,7 @@ struct request_t {
   string *user_agent;
   string *accept;
   string *connection;
+  bool keep_alive;
 } typedef request_t;
 
 struct response_t {
@@ -20,9 +115,32 @@ struct response_t {
   string *content_type;
   string *content_length;
   string *server;
+  string *connection;
   string *body;
 } typedef response_t;
 
+/**
+ * Response as it is written to the client. The serialized status line and headers (head) and the
+ * body are kept as separate segments, so the body is never copied behind the head. The body may
+ * also be the content of a file cache entry the response holds a reference to (cached), or a file
+ * that is sent directly from its file descriptor (file_fd is -1 if there is none). The file
+ * descriptor is closed with the response unless it belongs to the cache entry. The head and the body
+ * may borrow prepared data (e.g. of an error response), they are freed with the response unless it
+ * has been allocated from an arena.
+ */
+struct encoded_response_t {
+  string *head;
+  string *body;
+  file_cache_entry *cached;
+  int file_fd;
+  off_t file_offset;
+  size_t file_length;
+  // the response and its head are allocated from an arena (released together with it)
+  bool in_arena;
+  // next response queued on the same connection
+  struct encoded_response_t *next;
+} typedef encoded_response_t;
+
 /**
  * @brief Create a new request object
  * @warning This function will allocate memory for the request object and all its fields
@@ -43,6 +161,30 @@ request_t *new_request();
  */
 response_t *new_response();
 
+/**
+ * @brief Create a new encoded response object
+ * @warning This function will allocate memory for the head, the body is NULL and there is no file
+ *
+ * Returns NULL if memory allocation fails
+ *
+ * @return Created encoded response object
+ */
+encoded_response_t *new_encoded_response();
+
+/**
+ * @brief Create a new encoded response object in an arena
+ * @warning The head and the body have to be allocated from the arena or borrowed (e.g. with
+ * str_borrow_arena()), free_encoded_response() only releases the cache entry and the file of the
+ * response, a heap allocated body is not freed
+ *
+ * Same as new_encoded_response() if the arena is NULL.
+ * Returns NULL if memory allocation fails
+ *
+ * @param arena The arena the response and its head are allocated from
+ * @return Created encoded response object
+ */
+encoded_response_t *new_encoded_response_arena(arena *arena);
+
 /**
  * @brief Free the memory allocated for a request object
  * @warning This function will check if the given pointer is NULL
@@ -63,6 +205,26 @@ void free_request(request_t **request);
  */
 void free_response(response_t **response);
 
+/**
+ * @brief Free the memory allocated for an encoded response object, release its cache entry and
+ * close its file
+ * @warning This function will check if the given pointer is NULL
+ *
+ * Returns if the encoded response object is NULL. The response and head of a response created in an
+ * arena are released together with the arena instead.
+ *
+ * @param response Encoded response object to be freed
+ */
+void free_encoded_response(encoded_response_t **response);
+
+/**
+ * @brief Get the number of bytes of an encoded response (head, body and file)
+ *
+ * @param response Encoded response object
+ * @return The length of the encoded response
+ */
+size_t get_encoded_response_length(encoded_response_t *response);
+
 /**
  * @brief Update the content length of a response object
  *
@@ -73,6 +235,26 @@ void free_response(response_t **response);
  */
 void update_response_content_length(response_t *response);
 
+/**
+ * @brief Set the content length of a response object
+ * Used if the body is not stored in the response (e.g. it is sent from a file).
+ * Returns if the response object is NULL
+ * @param response Response object to be updated
+ * @param length The length of the body
+ */
+void set_response_content_length(response_t *response, size_t length);
+
+/**
+ * @brief Set the connection header of a response object
+ *
+ * The value is "keep-alive" if the connection stays open after the response, "close" otherwise.
+ * Returns if the response object is NULL
+ *
+ * @param response Response object to be updated
+ * @param keep_alive Whether the connection stays open
+ */
+void update_response_connection(response_t *response, bool keep_alive);
+
 /**
  * @brief Add a header to a raw HTTP response string
  * @warning This function will not add the semicolon at between the header and value
@@ -3,217 +3,518 @@
 #include "../http_server/http_server.h"
 #include <limits.h>
 
-int parse_request_line(string *raw_request, request_t *request) {
-  if (raw_request == NULL || request == NULL) {
-    return EXIT_FAILURE;
-  }
-
-  if (get_length(raw_request) > HTTP_MAX_REQUEST_SIZE) {
-    return EXIT_FAILURE;
+request_method parse_request_method(str_view method) {
+  static const char *methods[] = {
+      [REQUEST_METHOD_GET] = HTTP_METHOD_GET, [REQUEST_METHOD_HEAD] = "HEAD",
+      [REQUEST_METHOD_POST] = "POST",         [REQUEST_METHOD_PUT] = "PUT",
+      [REQUEST_METHOD_DELETE] = "DELETE",     [REQUEST_METHOD_CONNECT] = "CONNECT",
+      [REQUEST_METHOD_OPTIONS] = "OPTIONS",   [REQUEST_METHOD_TRACE] = "TRACE",
+      [REQUEST_METHOD_PATCH] = "PATCH"};
+
+  for (size_t i = REQUEST_METHOD_GET; i < sizeof(methods) / sizeof(methods[0]); i++) {
+    if (str_view_cmp(method, methods[i]) == 0) {
+      return (request_method)i;
+    }
   }
 
-  enum { METHOD, RESOURCE, VERSION } segment = METHOD;
-  size_t segment_start = 0;
-  string *segments[] = {request->method, request->resource, request->version};
+  return REQUEST_METHOD_UNKNOWN;
+}
 
-  for (size_t i = 0; i <= get_length(raw_request); i++) {
-    unsigned char current = (i < get_length(raw_request)) ? (char)(raw_request->str[i]) : '\n';
+request_version parse_request_version(str_view version) {
+  if (str_view_cmp(version, HTTP_VERSION_1_1) == 0) {
+    return REQUEST_VERSION_1_1;
+  }
 
-    if (segment > VERSION) {
-      // check if the end of line is valid
-      if (current == '\n') {
-        break;
-      }
+  if (str_view_cmp(version, HTTP_VERSION_1_0) == 0) {
+    return REQUEST_VERSION_1_0;
+  }
 
-      // more than 3 segments
-      return EXIT_FAILURE;
-    }
+  return REQUEST_VERSION_UNKNOWN;
+}
 
-    // check for invalid characters between segments
-    if (current == '\0' || current == '\n') {
-      break;
+/**
+ * @brief Parse the request line into the method, resource and version views
+ *
+ * @param raw_request Raw HTTP request string
+ * @param request Request view to store the parsed data
+ * @return The offset of the first header line, 0 if the request line is invalid
+ */
+static size_t parse_request_line(string *raw_request, request_view *request) {
+  static const char delimiters[] = {' ', '\r', '\n', '\0'};
+  const char *raw = raw_request->str;
+  size_t length = raw_request->len;
+  str_view *segments[] = {&request->method, &request->resource, &request->version};
+  size_t segment = 0;
+  size_t i = 0;
+
+  while (true) {
+    // jumps over the bytes of a segment at once
+    str_view rest = {.str = raw + i, .len = length - i};
+    const char *delimiter = str_find_any(rest, delimiters, sizeof(delimiters));
+    size_t end = delimiter == NULL ? length : (size_t)(delimiter - raw);
+
+    // the end of the input counts as the end of the line
+    bool line_end = end == length || raw[end] == '\n' || raw[end] == '\0';
+
+    // only the end of the line may follow the version
+    if (segment > 2 && (end > i || !line_end)) {
+      return 0;
     }
 
-    if (current != ' ' && current != '\r') {
-      continue;
+    if (line_end) {
+      return end + 1;
     }
 
     // check if the end of the line is valid
-    if (current == '\r' && raw_request->str[i + 1] != '\n') {
-      return EXIT_FAILURE;
-    }
-
-    string *current_segment = segments[segment];
-
-    if (current_segment == NULL) {
-      return EXIT_FAILURE;
+    if (raw[end] == '\r' && (end + 1 >= length || raw[end + 1] != '\n')) {
+      return 0;
     }
 
-    str_cat(current_segment, raw_request->str + segment_start, i - segment_start);
+    *segments[segment] = (str_view){.str = raw + i, .len = end - i};
 
     segment++;
-    segment_start = i + 1;
+    i = end + 1;
   }
+}
 
-  return EXIT_SUCCESS;
+/// character class of tchar (RFC 9110 5.6.2), the bytes of header names
+#define HEADER_CHAR_TOKEN 1
+
+/// character class of field-vchar, SP and HTAB (RFC 9110 5.5), the bytes of header values
+#define HEADER_CHAR_VALUE 2
+
+/**
+ * Character classes of all bytes (HEADER_CHAR_TOKEN | HEADER_CHAR_VALUE).
+ */
+static const unsigned char header_chars[256] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 0, 0, 0, 0, 0, 0, // 0x00
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, // 0x10
+    2, 3, 2, 3, 3, 3, 3, 3, 2, 2, 3, 3, 2, 3, 3, 2, // 0x20
+    3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 2, 2, 2, 2, 2, 2, // 0x30
+    2, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, // 0x40
+    3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 2, 2, 2, 3, 3, // 0x50
+    3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, // 0x60
+    3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 2, 3, 2, 3, 0, // 0x70
+    2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, // 0x80 (obs-text)
+    2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, // 0x90
+    2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, // 0xa0
+    2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, // 0xb0
+    2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, // 0xc0
+    2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, // 0xd0
+    2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, // 0xe0
+    2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, // 0xf0
+};
+
+/**
+ * States of the header tokenizer.
+ */
+enum header_state {
+  HEADER_STATE_LINE_START,
+  HEADER_STATE_NAME,
+  HEADER_STATE_VALUE,
+  HEADER_STATE_LINE_END,
+  HEADER_STATE_HEAD_END,
+  HEADER_STATE_SKIP_LINE
+} typedef header_state;
+
+/**
+ * Names of the known request headers (lowercase).
+ */
+static const char *request_header_names[REQUEST_HEADER_COUNT] = {
+    [REQUEST_HEADER_ACCEPT] = "accept",
+    [REQUEST_HEADER_ACCEPT_ENCODING] = "accept-encoding",
+    [REQUEST_HEADER_ACCEPT_LANGUAGE] = "accept-language",
+    [REQUEST_HEADER_AUTHORIZATION] = "authorization",
+    [REQUEST_HEADER_CACHE_CONTROL] = "cache-control",
+    [REQUEST_HEADER_CONNECTION] = "connection",
+    [REQUEST_HEADER_CONTENT_LENGTH] = "content-length",
+    [REQUEST_HEADER_CONTENT_TYPE] = "content-type",
+    [REQUEST_HEADER_COOKIE] = "cookie",
+    [REQUEST_HEADER_EXPECT] = "expect",
+    [REQUEST_HEADER_HOST] = "host",
+    [REQUEST_HEADER_IF_MATCH] = "if-match",
+    [REQUEST_HEADER_IF_MODIFIED_SINCE] = "if-modified-since",
+    [REQUEST_HEADER_IF_NONE_MATCH] = "if-none-match",
+    [REQUEST_HEADER_IF_RANGE] = "if-range",
+    [REQUEST_HEADER_IF_UNMODIFIED_SINCE] = "if-unmodified-since",
+    [REQUEST_HEADER_ORIGIN] = "origin",
+    [REQUEST_HEADER_RANGE] = "range",
+    [REQUEST_HEADER_REFERER] = "referer",
+    [REQUEST_HEADER_TE] = "te",
+    [REQUEST_HEADER_TRANSFER_ENCODING] = "transfer-encoding",
+    [REQUEST_HEADER_UPGRADE] = "upgrade",
+    [REQUEST_HEADER_USER_AGENT] = "user-agent",
+};
+
+/// number of slots of the perfect hash table of the known header names (a power of 2)
+#define REQUEST_HEADER_SLOTS 64
+
+/**
+ * Perfect hash table of the known header names: header_slot() of every name is a different slot.
+ * The hash function was chosen by trying small multipliers until no two names collide, the table
+ * has to be updated together with request_header_names (test_parse_request_header_name() checks
+ * that every name is found).
+ */
+static const request_header request_header_slots[REQUEST_HEADER_SLOTS] = {
+    [0] = REQUEST_HEADER_EXPECT,
+    [2] = REQUEST_HEADER_ACCEPT_LANGUAGE,
+    [4] = REQUEST_HEADER_ACCEPT_ENCODING,
+    [6] = REQUEST_HEADER_ORIGIN,
+    [8] = REQUEST_HEADER_ACCEPT,
+    [9] = REQUEST_HEADER_AUTHORIZATION,
+    [16] = REQUEST_HEADER_TRANSFER_ENCODING,
+    [18] = REQUEST_HEADER_UPGRADE,
+    [21] = REQUEST_HEADER_COOKIE,
+    [27] = REQUEST_HEADER_CONTENT_TYPE,
+    [32] = REQUEST_HEADER_CONTENT_LENGTH,
+    [34] = REQUEST_HEADER_CONNECTION,
+    [35] = REQUEST_HEADER_CACHE_CONTROL,
+    [36] = REQUEST_HEADER_USER_AGENT,
+    [38] = REQUEST_HEADER_RANGE,
+    [40] = REQUEST_HEADER_HOST,
+    [43] = REQUEST_HEADER_IF_RANGE,
+    [46] = REQUEST_HEADER_IF_MATCH,
+    [51] = REQUEST_HEADER_IF_NONE_MATCH,
+    [52] = REQUEST_HEADER_IF_MODIFIED_SINCE,
+    [53] = REQUEST_HEADER_REFERER,
+    [54] = REQUEST_HEADER_IF_UNMODIFIED_SINCE,
+    [63] = REQUEST_HEADER_TE,
+};
+
+/**
+ * @brief Get the slot of a header name in the perfect hash table
+ *
+ * Only the length, the first and the last character are used, the characters are lowercased.
+ *
+ * @param name The header name (not empty)
+ * @return The slot
+ */
+static size_t header_slot(str_view name) {
+  unsigned char first = (unsigned char)name.str[0] | 0x20;
+  unsigned char last = (unsigned char)name.str[name.len - 1] | 0x20;
+
+  return (name.len + first * 14 + last) & (REQUEST_HEADER_SLOTS - 1);
 }
 
-void map_header(string *header_name, string *header_value, request_t *request) {
-  if (header_name == NULL || header_value == NULL || request == NULL) {
-    return;
+request_header parse_request_header_name(str_view name) {
+  if (name.len == 0) {
+    return REQUEST_HEADER_UNKNOWN;
   }
 
-  if (str_cmp(header_name, REQUEST_HEADER_HOST) == 0) {
-    str_set(request->host, get_char_str(header_value), get_length(header_value));
-    return;
-  }
+  request_header header = request_header_slots[header_slot(name)];
 
-  if (str_cmp(header_name, REQUEST_HEADER_USER_AGENT) == 0) {
-    str_set(request->user_agent, get_char_str(header_value), get_length(header_value));
-    return;
+  // the slot has to be confirmed, every unknown name also hashes to some slot
+  if (header == REQUEST_HEADER_UNKNOWN ||
+      str_view_case_cmp(name, request_header_names[header]) != 0) {
+    return REQUEST_HEADER_UNKNOWN;
   }
 
-  if (str_cmp(header_name, REQUEST_HEADER_ACCEPT) == 0) {
-    str_set(request->accept, get_char_str(header_value), get_length(header_value));
-    return;
+  return header;
+}
+
+const char *get_request_header_name(request_header header) {
+  if (header <= REQUEST_HEADER_UNKNOWN || header >= REQUEST_HEADER_COUNT) {
+    return NULL;
   }
 
-  if (str_cmp(header_name, REQUEST_HEADER_CONNECTION) == 0) {
-    str_set(request->connection, get_char_str(header_value), get_length(header_value));
-    return;
+  return request_header_names[header];
+}
+
+str_view get_request_header(request_view *request, request_header header) {
+  if (header <= REQUEST_HEADER_UNKNOWN || header >= REQUEST_HEADER_COUNT ||
+      request->header_index[header] == 0) {
+    return (str_view){.str = "", .len = 0};
   }
+
+  return request->headers[request->header_index[header] - 1].value;
 }
 
-string *get_request_head(string *raw_request) {
-  if (raw_request == NULL) {
-    return NULL;
+/**
+ * @brief Add a header line to a request view
+ *
+ * Sets header_overflow instead if the request view is full.
+ *
+ * @param request The request view
+ * @param name The header name
+ * @param value The start of the header value
+ * @param length The length of the header value (the value is trimmed)
+ */
+static void add_request_header(request_view *request, str_view name, const char *value,
+                               size_t length) {
+  if (request->header_count == REQUEST_MAX_HEADERS) {
+    request->header_overflow = true;
+    return;
   }
 
-  string *double_line_break = str_cpy(HTTP_LINE_BREAK, strlen(HTTP_LINE_BREAK));
-  double_line_break = str_cat(double_line_break, HTTP_LINE_BREAK, strlen(HTTP_LINE_BREAK));
+  request_header header = parse_request_header_name(name);
 
-  char *end_of_head = str_str(raw_request, double_line_break);
-  free_str(double_line_break);
+  request->headers[request->header_count] =
+      (request_header_field){.id = header,
+                             .name = name,
+                             .value = str_view_trim((str_view){.str = value, .len = length})};
+  request->header_count++;
 
-  if (end_of_head == NULL) {
-    return str_cpy(get_char_str(raw_request), get_length(raw_request));
+  // only the first occurrence is found by get_request_header()
+  if (header != REQUEST_HEADER_UNKNOWN && request->header_index[header] == 0) {
+    request->header_index[header] = (unsigned char)request->header_count;
   }
+}
 
-  // we add 2 because we want to keep one \r\n at the end of the head
-  size_t head_len = end_of_head + 2 - get_char_str(raw_request);
+/**
+ * @brief Tokenize the header lines in one pass and add them to the request view
+ *
+ * Every byte is looked at once: names have to consist of tchar, values of field-vchar, SP and HTAB.
+ * Lines end with \r\n or a bare \n, the empty line ends the head. Malformed lines (e.g. without a
+ * colon, with a space before the colon, with a control character or an obsolete line folding) and
+ * a line that is cut off by the end of the input are skipped. The names are classified once they
+ * end (see add_request_header()).
+ *
+ * @param raw_request Raw HTTP request string
+ * @param offset The offset of the first header line
+ * @param request Request view to store the parsed data
+ */
+static void parse_request_headers(string *raw_request, size_t offset, request_view *request) {
+  const unsigned char *raw = (const unsigned char *)raw_request->str;
+  size_t length = raw_request->len;
+  header_state state = HEADER_STATE_LINE_START;
+  size_t start = offset;
+  size_t end = offset;
+  str_view name = {.str = raw_request->str, .len = 0};
+
+  for (size_t i = offset; i < length; i++) {
+    unsigned char current = raw[i];
+
+    switch (state) {
+    case HEADER_STATE_LINE_START:
+      if (current == '\r') {
+        state = HEADER_STATE_HEAD_END;
+        break;
+      }
 
-  return str_cpy(get_char_str(raw_request), head_len);
-}
+      // the empty line ends the head
+      if (current == '\n') {
+        return;
+      }
 
-string *find_request_header(string *raw_request, string *header_name) {
-  if (raw_request == NULL || header_name == NULL) {
-    return NULL;
-  }
-  // this is the position of the header in the raw request
-  char *header_occurrence = str_str_ignore_case(raw_request, header_name);
+      start = i;
 
-  if (header_occurrence == NULL) {
-    return NULL;
-  }
-  // this is the start of the header value
-  char *header_value_start = header_occurrence + get_length(header_name);
+      // lines starting with whitespace (obsolete line folding) are skipped as well
+      state = (header_chars[current] & HEADER_CHAR_TOKEN) != 0 ? HEADER_STATE_NAME
+                                                                : HEADER_STATE_SKIP_LINE;
+      break;
+
+    case HEADER_STATE_NAME:
+      if (current == ':') {
+        name = (str_view){.str = (const char *)raw + start, .len = i - start};
+        start = i + 1;
+        state = HEADER_STATE_VALUE;
+        break;
+      }
 
-  while (*header_value_start == ' ') {
-    header_value_start++;
+      if ((header_chars[current] & HEADER_CHAR_TOKEN) == 0) {
+        state = current == '\n' ? HEADER_STATE_LINE_START : HEADER_STATE_SKIP_LINE;
+      }
 
-    if (header_value_start >= get_char_str(raw_request) + get_length(raw_request)) {
-      return NULL;
+      break;
+
+    case HEADER_STATE_VALUE: {
+      // the regular bytes of the value are skipped at once, only control characters (including
+      // the end of the line) have to be looked at
+      str_view rest = {.str = (const char *)raw + i, .len = length - i};
+      const char *control = str_find_control(rest);
+
+      if (control == NULL) {
+        return;
+      }
+
+      i = (const unsigned char *)control - raw;
+      current = raw[i];
+
+      if (current == '\r') {
+        end = i;
+        state = HEADER_STATE_LINE_END;
+        break;
+      }
+
+      if (current == '\n') {
+        add_request_header(request, name, (const char *)raw + start, i - start);
+        state = HEADER_STATE_LINE_START;
+        break;
+      }
+
+      if ((header_chars[current] & HEADER_CHAR_VALUE) == 0) {
+        state = HEADER_STATE_SKIP_LINE;
+      }
+
+      break;
+    }
+
+    case HEADER_STATE_LINE_END:
+      if (current != '\n') {
+        state = HEADER_STATE_SKIP_LINE;
+        break;
+      }
+
+      add_request_header(request, name, (const char *)raw + start, end - start);
+      state = HEADER_STATE_LINE_START;
+      break;
+
+    case HEADER_STATE_HEAD_END:
+      if (current == '\n') {
+        return;
+      }
+
+      state = HEADER_STATE_SKIP_LINE;
+      break;
+
+    case HEADER_STATE_SKIP_LINE:
+      if (current == '\n') {
+        state = HEADER_STATE_LINE_START;
+      }
+
+      break;
     }
   }
+}
 
-  size_t after_header_len =
-      get_char_str(raw_request) + get_length(raw_request) - header_value_start;
+int parse_request_view(string *raw_request, request_view *request) {
+  if (raw_request == NULL || request == NULL) {
+    return EXIT_FAILURE;
+  }
 
-  if (after_header_len <= 0) {
-    return NULL;
+  if (get_length(raw_request) > HTTP_MAX_REQUEST_SIZE) {
+    return EXIT_FAILURE;
   }
-  // this is the string containing the rest of the request after the header
-  string *after_header = str_cpy(header_value_start, after_header_len);
 
-  // search for the end of the line
-  string *line_break = str_cpy(HTTP_LINE_BREAK, strlen(HTTP_LINE_BREAK));
-  char *header_end = str_str(after_header, line_break);
+  // all fields start as empty views into the raw request (the header array is not cleared, only
+  // the first header_count entries are used)
+  str_view empty = {.str = raw_request->str, .len = 0};
+  request->method = empty;
+  request->resource = empty;
+  request->version = empty;
+  request->header_count = 0;
+  request->header_overflow = false;
+  memset(request->header_index, 0, sizeof(request->header_index));
+  request->method_id = REQUEST_METHOD_UNKNOWN;
+  request->version_id = REQUEST_VERSION_UNKNOWN;
+  request->keep_alive = false;
 
-  if (header_end == NULL) {
-    free_str(line_break);
-    free_str(after_header);
-    return NULL;
+  size_t headers_offset = parse_request_line(raw_request, request);
+
+  if (headers_offset == 0) {
+    return EXIT_FAILURE;
   }
 
-  // this is the string containing the header value
-  size_t header_value_len = header_end - get_char_str(after_header);
-  string *header_value = str_cpy(header_value_start, header_value_len);
+  request->method_id = parse_request_method(request->method);
+  request->version_id = parse_request_version(request->version);
 
-  free_str(line_break);
-  free_str(after_header);
+  parse_request_headers(raw_request, headers_offset, request);
 
-  // header_value should not contain "\r", "\n" or "\0"
-  string *r = str_cpy("\r", 1);
-  string *n = str_cpy("\n", 1);
-  string *zero = str_cpy("\0", 1);
+  return EXIT_SUCCESS;
+}
 
-  int contains_invalid_chars = str_str(header_value, r) != NULL ||
-                               str_str(header_value, n) != NULL ||
-                               str_str(header_value, zero) != NULL;
+request_view view_request(request_t *request) {
+  request_view view = {.method = str_view_of(request->method),
+                       .resource = str_view_of(request->resource),
+                       .version = str_view_of(request->version),
+                       .keep_alive = request->keep_alive};
 
-  free_str(r);
-  free_str(n);
-  free_str(zero);
+  view.method_id = parse_request_method(view.method);
+  view.version_id = parse_request_version(view.version);
 
-  if (contains_invalid_chars) {
-    free_str(header_value);
-    return NULL;
+  // the request object only has the values of these headers
+  string *values[] = {request->host, request->user_agent, request->accept, request->connection};
+  request_header headers[] = {REQUEST_HEADER_HOST, REQUEST_HEADER_USER_AGENT, REQUEST_HEADER_ACCEPT,
+                              REQUEST_HEADER_CONNECTION};
+
+  for (size_t i = 0; i < sizeof(headers) / sizeof(headers[0]); i++) {
+    if (get_length(values[i]) > 0) {
+      str_view name = {.str = request_header_names[headers[i]],
+                       .len = strlen(request_header_names[headers[i]])};
+
+      add_request_header(&view, name, values[i]->str, values[i]->len);
+    }
   }
 
-  str_cut_spaces(header_value);
+  return view;
+}
 
-  return header_value;
+void reset_request_parser(request_parser *parser) {
+  *parser = (request_parser){
+      .status = REQUEST_PARSE_INCOMPLETE, .scanned = 0, .matched = 0, .length = 0, .error = 0};
 }
 
-int parse_request_headers(string *raw_request, request_t *request) {
-  if (raw_request == NULL || request == NULL) {
-    return EXIT_FAILURE;
+request_parse_status parse_request_incremental(request_parser *parser, const char *data,
+                                               size_t length) {
+  static const char end_of_head[] = HTTP_LINE_BREAK HTTP_LINE_BREAK;
+  size_t i = parser->scanned;
+
+  if (parser->status != REQUEST_PARSE_INCOMPLETE) {
+    return parser->status;
   }
 
-  string *request_raw_head = get_request_head(raw_request);
+  while (i < length) {
+    // nothing matched yet, so the end of the head can only start at the next \r
+    if (parser->matched == 0) {
+      const char *next = memchr(data + i, '\r', length - i);
 
-  if (request_raw_head == NULL) {
-    return EXIT_FAILURE;
-  }
+      if (next == NULL) {
+        i = length;
+        break;
+      }
 
-  const char *request_headers[REQUEST_HEADER_COUNT] = {
-      REQUEST_HEADER_HOST, REQUEST_HEADER_USER_AGENT, REQUEST_HEADER_ACCEPT,
-      REQUEST_HEADER_CONNECTION};
+      i = next - data;
+    }
 
-  string *header_name = _new_string();
+    if (data[i] == end_of_head[parser->matched]) {
+      parser->matched++;
+    } else {
+      // a mismatching \r can be the start of the end of the head
+      parser->matched = data[i] == '\r' ? 1 : 0;
+    }
 
-  for (size_t i = 0; i < REQUEST_HEADER_COUNT; ++i) {
-    str_set(header_name, request_headers[i], strlen(request_headers[i]));
-    str_to_lower(header_name);
+    i++;
 
-    string *header_value = find_request_header(request_raw_head, header_name);
+    if (parser->matched == sizeof(end_of_head) - 1) {
+      parser->scanned = i;
+      parser->length = i;
+      parser->status = REQUEST_PARSE_COMPLETE;
 
-    if (header_value == NULL) {
-      continue;
+      return parser->status;
     }
+  }
+
+  parser->scanned = i;
+
+  // the rest of an oversized head is not waited for
+  if (parser->scanned > HTTP_MAX_REQUEST_SIZE) {
+    parser->error = HTTP_REQUEST_HEADER_FIELDS_TOO_LARGE;
+    parser->status = REQUEST_PARSE_ERROR;
+  }
+
+  return parser->status;
+}
 
-    map_header(header_name, header_value, request);
-    free_str(header_value);
+size_t get_request_length(string *raw_request, size_t offset) {
+  if (raw_request == NULL || offset >= get_length(raw_request)) {
+    return 0;
   }
 
-  free_str(header_name);
-  free_str(request_raw_head);
+  request_parser parser;
+  reset_request_parser(&parser);
 
-  return EXIT_SUCCESS;
+  if (parse_request_incremental(&parser, raw_request->str + offset,
+                                get_length(raw_request) - offset) != REQUEST_PARSE_COMPLETE) {
+    return 0;
+  }
+
+  return parser.length;
 }
 
 request_t *parse_request_string(string *raw_request) {
-  if (raw_request == NULL) {
+  request_view view;
+
+  if (parse_request_view(raw_request, &view) == EXIT_FAILURE) {
     return NULL;
   }
 
@@ -223,160 +524,288 @@ request_t *parse_request_string(string *raw_request) {
     return NULL;
   }
 
-  int result_line = parse_request_line(raw_request, request);
+  str_set(request->method, view.method.str, view.method.len);
+  str_set(request->resource, view.resource.str, view.resource.len);
+  str_set(request->version, view.version.str, view.version.len);
+  string *values[] = {request->host, request->user_agent, request->accept, request->connection};
+  request_header headers[] = {REQUEST_HEADER_HOST, REQUEST_HEADER_USER_AGENT, REQUEST_HEADER_ACCEPT,
+                              REQUEST_HEADER_CONNECTION};
 
-  if (result_line == EXIT_FAILURE) {
-    free_request(&request);
-    return NULL;
+  for (size_t i = 0; i < sizeof(headers) / sizeof(headers[0]); i++) {
+    str_view value = get_request_header(&view, headers[i]);
+
+    str_set(values[i], value.str, value.len);
   }
 
-  int result_header = parse_request_headers(raw_request, request);
+  return request;
+}
 
-  if (result_header == EXIT_FAILURE) {
-    free_request(&request);
-    return NULL;
+static bool add_response_fields(string *head, response_t *response, bool connection) {
+  // status line (version, status code, status message)
+  generate_response_status_line(head, response->version, response->status_code,
+                                response->status_message);
+
+  // headers
+  add_response_string_header(head, CONTENT_TYPE_HEADER, response->content_type);
+  add_response_string_header(head, CONTENT_LENGTH_HEADER, response->content_length);
+  add_response_string_header(head, SERVER_HEADER, response->server);
+
+  if (connection && get_length(response->connection) > 0) {
+    add_response_string_header(head, CONNECTION_HEADER, response->connection);
   }
 
-  return request;
+  if (str_view_equal(str_view_of(response->status_message),
+                     STR_VIEW_LITERAL(STATUS_MESSAGE_UNAUTHORIZED))) {
+    add_response_string_header(head, WWW_AUTHENTICATE_HEADER, &STR_LITERAL(WWW_AUTHENTICATE_REALM));
+  }
+
+  return true;
 }
 
-string *serialize_response(response_t *response) {
+encoded_response_t *encode_response(response_t *response) {
   if (response == NULL) {
     return NULL;
   }
 
-  string *encoded_response = _new_string();
+  encoded_response_t *encoded = new_encoded_response();
 
-  if (encoded_response == NULL) {
+  if (encoded == NULL) {
     return NULL;
   }
 
-  // status line (version, status code, status message)
-  generate_response_status_line(encoded_response, response->version, response->status_code,
-                                response->status_message);
+  string *encoded_response = encoded->head;
 
-  // headers
-  add_response_string_header(encoded_response, CONTENT_TYPE_HEADER, response->content_type);
-  add_response_string_header(encoded_response, CONTENT_LENGTH_HEADER, response->content_length);
-  add_response_string_header(encoded_response, SERVER_HEADER, response->server);
+  if (!add_response_fields(encoded_response, response, true)) {
+    free_encoded_response(&encoded);
+    return NULL;
+  }
 
-  if (str_cmp(response->status_message, STATUS_MESSAGE_UNAUTHORIZED) == 0) {
-    string *auth_header = _new_string();
+  str_cat(encoded_response, HTTP_LINE_BREAK, STR_LITERAL_LEN(HTTP_LINE_BREAK));
 
-    if (auth_header == NULL) {
-      free_str(encoded_response);
-      return NULL;
-    }
+  // the body is taken over, not copied
+  encoded->body = response->body;
+  response->body = NULL;
 
-    str_set(auth_header, WWW_AUTHENTICATE_REALM, strlen(WWW_AUTHENTICATE_REALM));
+  return encoded;
+}
 
-    add_response_string_header(encoded_response, WWW_AUTHENTICATE_HEADER, auth_header);
-    free_str(auth_header);
+string *encode_response_fields(response_t *response) {
+  if (response == NULL) {
+    return NULL;
   }
 
-  str_cat(encoded_response, HTTP_LINE_BREAK, strlen(HTTP_LINE_BREAK));
+  string *fields = _new_string();
 
-  // body
-  str_cat(encoded_response, response->body->str, get_length(response->body));
+  if (fields == NULL) {
+    return NULL;
+  }
 
-  return encoded_response;
+  if (!add_response_fields(fields, response, false)) {
+    free_str(fields);
+    return NULL;
+  }
+
+  return fields;
 }
 
-string *decode_url(string *str) {
-  if (str == NULL) {
+encoded_response_t *encode_prepared_response(string *fields, bool keep_alive, arena *arena) {
+  if (fields == NULL) {
     return NULL;
   }
 
-  string *decoded = _new_string();
+  encoded_response_t *encoded = new_encoded_response_arena(arena);
 
-  if (decoded == NULL) {
+  if (encoded == NULL) {
     return NULL;
   }
 
-  for (int i = 0; i < get_length(str); i++) {
-    char current = str->str[i];
+  str_view connection = keep_alive ? STR_VIEW_LITERAL(CONNECTION_KEEP_ALIVE)
+                                   : STR_VIEW_LITERAL(CONNECTION_CLOSE);
+
+  // the head is the last allocation of the arena, so it grows in place
+  str_cat_arena(arena, encoded->head, get_char_str(fields), get_length(fields));
+  str_cat_arena(arena, encoded->head, CONNECTION_HEADER, STR_LITERAL_LEN(CONNECTION_HEADER));
+  str_cat_arena(arena, encoded->head, connection.str, connection.len);
+  str_cat_arena(arena, encoded->head, HTTP_LINE_BREAK HTTP_LINE_BREAK,
+                STR_LITERAL_LEN(HTTP_LINE_BREAK HTTP_LINE_BREAK));
+
+  return encoded;
+}
+
+/**
+ * Value of every hex digit, URL_HEX_INVALID for all other bytes.
+ */
+static const unsigned char url_hex_values[256] = {
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, // 0x00
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, // 0x10
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, // 0x20
+    0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, // 0x30
+    0xff, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, // 0x40
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, // 0x50
+    0xff, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, // 0x60
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, // 0x70
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, // 0x80
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, // 0x90
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, // 0xa0
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, // 0xb0
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, // 0xc0
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, // 0xd0
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, // 0xe0
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, // 0xf0
+};
+
+/**
+ * Unreserved characters of a URL (RFC 3986: ALPHA, DIGIT, '-', '.', '_', '~'), they are not encoded.
+ */
+static const unsigned char url_unreserved[256] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, // 0x00
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, // 0x10
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 0, // 0x20
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, // 0x30
+    0, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, // 0x40
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 1, // 0x50
+    0, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, // 0x60
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 1, 0, // 0x70
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, // 0x80
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, // 0x90
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, // 0xa0
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, // 0xb0
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, // 0xc0
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, // 0xd0
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, // 0xe0
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, // 0xf0
+};
+
+int decode_url_to(char *dest, const char *src, size_t length, size_t *decoded) {
+  static const char escapes[] = {'%', '+'};
+  size_t written = 0;
+  size_t i = 0;
+
+  while (i < length) {
+    // everything up to the next escape is copied at once (nothing to do in place before the first
+    // escape)
+    str_view rest = {.str = src + i, .len = length - i};
+    const char *escape = str_find_any(rest, escapes, sizeof(escapes));
+    size_t run = escape == NULL ? rest.len : (size_t)(escape - rest.str);
+
+    if (dest + written != src + i) {
+      memmove(dest + written, src + i, run);
+    }
+
+    written += run;
+    i += run;
+
+    if (i == length) {
+      break;
+    }
 
     // plus signs should be decoded as spaces
-    if (current == '+') {
-      str_cat(decoded, " ", 1);
+    if (src[i] == '+') {
+      dest[written++] = ' ';
+      i++;
       continue;
     }
 
-    if (current == '%' && i + 1 < get_length(str)) {
-      int new_char = '\0';
-      char first = str->str[i + 1];
-      char second = str->str[i + 2];
-
-      if (first >= '0' && first <= '9') {
-        new_char = first - '0';
-      } else if (first >= 'a' && first <= 'f') {
-        new_char = first - 'a' + 10;
-      } else if (first >= 'A' && first <= 'F') {
-        new_char = first - 'A' + 10;
-      }
+    // a percent sign has to be followed by two hex digits
+    if (length - i < 3) {
+      return EXIT_FAILURE;
+    }
 
-      new_char <<= 4;
+    unsigned char high = url_hex_values[(unsigned char)src[i + 1]];
+    unsigned char low = url_hex_values[(unsigned char)src[i + 2]];
 
-      if (second >= '0' && second <= '9') {
-        new_char |= (char)(second - '0');
-      } else if (second >= 'a' && second <= 'f') {
-        new_char |= (char)(second - 'a' + 10);
-      } else if (second >= 'A' && second <= 'F') {
-        new_char |= (char)(second - 'A' + 10);
-      }
+    // a null byte would cut the path short once it is used as a C string
+    if (high == URL_HEX_INVALID || low == URL_HEX_INVALID || (high | low) == 0) {
+      return EXIT_FAILURE;
+    }
 
-      // We need to check if the new character is within the valid range of a char
-      if (new_char > CHAR_MAX) {
-        continue;
-      }
+    // every byte is kept (e.g. the bytes of a percent encoded UTF-8 character)
+    dest[written++] = (char)(high << 4 | low);
+    i += 3;
+  }
 
-      str_cat(decoded, (const char *)&new_char, 1);
-      i += 2;
+  *decoded = written;
 
+  return EXIT_SUCCESS;
+}
+
+int decode_url_in_place(char *str, size_t *length) {
+  return decode_url_to(str, str, *length, length);
+}
+
+size_t encode_url_to(char *dest, const char *src, size_t length) {
+  size_t written = 0;
+  size_t i = 0;
+
+  while (i < length) {
+    // runs of unreserved characters are copied at once
+    size_t end = i;
+
+    while (end < length && url_unreserved[(unsigned char)src[end]]) {
+      end++;
+    }
+
+    memcpy(dest + written, src + i, end - i);
+    written += end - i;
+    i = end;
+
+    if (i == length) {
+      break;
+    }
+
+    unsigned char current = (unsigned char)src[i++];
+
+    // spaces should be encoded as '+'
+    if (current == ' ') {
+      dest[written++] = '+';
       continue;
     }
 
-    // other characters should be copied
-    str_cat(decoded, str->str + i, 1);
+    // other characters should be encoded as '%XX'
+    dest[written++] = '%';
+    dest[written++] = HEX_CHARSET[current >> 4];
+    dest[written++] = HEX_CHARSET[current & 0x0f];
   }
 
-  return decoded;
+  return written;
 }
 
-string *encode_url(string *str) {
+string *decode_url(string *str) {
   if (str == NULL) {
     return NULL;
   }
 
-  string *encoded = _new_string();
+  string *decoded = str_cpy(get_char_str(str), get_length(str));
 
-  if (encoded == NULL) {
+  if (decoded == NULL) {
     return NULL;
   }
 
-  const char *hex = HEX_CHARSET;
+  if (decode_url_in_place(decoded->str, &decoded->len) == EXIT_FAILURE) {
+    free_str(decoded);
+    return NULL;
+  }
 
-  for (int i = 0; i < get_length(str); i++) {
-    char current = str->str[i];
+  decoded->str[decoded->len] = '\0';
 
-    // normal characters should be copied
-    if (current >= 'a' && current <= 'z' || current >= 'A' && current <= 'Z' ||
-        current >= '0' && current <= '9') {
-      str_cat(encoded, str->str + i, 1);
-      continue;
-    }
+  return decoded;
+}
 
-    // spaces should be encoded as '+'
-    if (current == ' ') {
-      str_cat(encoded, "+", 1);
-      continue;
-    }
+string *encode_url(string *str) {
+  if (str == NULL) {
+    return NULL;
+  }
 
-    // other characters should be encoded as '%XX'
-    str_cat(encoded, "%", 1);
-    str_cat(encoded, hex + (current >> 4), 1);
-    str_cat(encoded, hex + (current & 0x0f), 1);
+  string *encoded = _new_string();
+
+  if (encoded == NULL) {
+    return NULL;
   }
 
+  // the encoded string is written at once into an allocation that fits the longest encoding
+  str_reserve(encoded, URL_ENCODED_MAX_LENGTH(get_length(str)));
+  encoded->len = encode_url_to(encoded->str, str->str, get_length(str));
+  encoded->str[encoded->len] = '\0';
+
   return encoded;
-}
\ No newline at end of file
+}
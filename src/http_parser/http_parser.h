@@ -5,75 +5,165 @@
 
 #define HEX_CHARSET "0123456789ABCDEF"
 
-/// @warning has to be in lowercase!
-#define REQUEST_HEADER_COUNT 4
-#define REQUEST_HEADER_HOST "host:"
-#define REQUEST_HEADER_USER_AGENT "user-agent:"
-#define REQUEST_HEADER_ACCEPT "accept:"
-#define REQUEST_HEADER_CONNECTION "connection:"
+/**
+ * Marks a byte that is not a hex digit in the decoding table.
+ */
+#define URL_HEX_INVALID 0xff
+
+/**
+ * Maximum length of an URL encoded string of the given length (every byte encoded as `%XX`).
+ */
+#define URL_ENCODED_MAX_LENGTH(length) ((length) * 3)
 
 /**
- * @brief Parse the request line of a raw HTTP request string
+ * Result of an incremental parse step.
+ */
+enum request_parse_status {
+  REQUEST_PARSE_INCOMPLETE,
+  REQUEST_PARSE_COMPLETE,
+  REQUEST_PARSE_ERROR
+} typedef request_parse_status;
+
+/**
+ * State of an incremental request parser, it is kept across calls of parse_request_incremental()
+ * while the request arrives in fragments. All offsets are relative to the start of the request.
+ */
+struct request_parser {
+  request_parse_status status;
+  // number of bytes of the request that have been looked at
+  size_t scanned;
+  // number of bytes of the end of the head (\r\n\r\n) at the end of the scanned bytes
+  size_t matched;
+  // length of the request once it is complete
+  size_t length;
+  // HTTP status code of the error response once the request is invalid
+  int error;
+} typedef request_parser;
+
+/**
+ * @brief Reset an incremental request parser for the next request
+ *
+ * @param parser The parser
+ */
+void reset_request_parser(request_parser *parser);
+
+/**
+ * @brief Continue parsing a request that arrives in fragments
  *
- * Returns EXIT_FAILURE if the raw_request or request is NULL, if memory allocation fails or if the
- * request line is invalid. The raw_request is seen as invalid if it does not follow the HTTP/1.1
- * (or 1.0) request format: `METHOD RESOURCE VERSION\r\n`.
+ * Only the bytes after the ones looked at by the previous calls are scanned, so a request that
+ * arrives byte by byte is still parsed in linear time. The bytes that have been looked at before
+ * must not change between the calls, but they may be moved (e.g. into a larger buffer).
  *
- * @param raw_request Raw HTTP request string
- * @param request Request object to store the parsed data
- * @return int EXIT_SUCCESS if the request line was parsed successfully, EXIT_FAILURE otherwise
+ * A request is complete once its head is terminated by \r\n\r\n (request bodies are not
+ * supported), parser->length is its length then. The request is invalid (parser->error is
+ * HTTP_REQUEST_HEADER_FIELDS_TOO_LARGE) if more than HTTP_MAX_REQUEST_SIZE bytes do not contain
+ * the end of the head. Once the request is complete or invalid, the result does not change until
+ * the parser is reset.
+ *
+ * @param parser The parser of the request
+ * @param data The start of the request
+ * @param length The number of bytes of the request that have been received so far
+ * @return REQUEST_PARSE_INCOMPLETE if more bytes are needed, REQUEST_PARSE_COMPLETE if the
+ * request is complete or REQUEST_PARSE_ERROR if it is invalid
  */
-int parse_request_line(string *raw_request, request_t *request);
+request_parse_status parse_request_incremental(request_parser *parser, const char *data,
+                                               size_t length);
 
 /**
- * @brief Map a header name and value to the corresponding field in a request object
+ * @brief Get the length of the next complete request in a raw HTTP request string
  *
- * If the header_name is NULL, the header_value is NULL or the request is NULL, the function will
- * return without doing anything.
+ * A request is complete once its head is terminated by \r\n\r\n (request bodies are not
+ * supported). The search starts at offset, so pipelined requests can be split one after another.
+ * Use parse_request_incremental() if the request may still be incomplete.
  *
- * Implemented headers:
- * - Host: request->host
- * - User-Agent: request->user_agent
- * - Accept: request->accept
- * - Connection: request->connection
+ * Returns 0 if the raw_request is NULL or does not contain a complete request after offset.
  *
- * @param header_name Header name
- * @param header_value Header value
- * @param request Request object to store the mapped data
+ * @param raw_request Raw HTTP request string (may contain several requests)
+ * @param offset Start of the next request in raw_request
+ * @return Length of the request starting at offset, including the terminating \r\n\r\n
  */
-void map_header(string *header_name, string *header_value, request_t *request);
+size_t get_request_length(string *raw_request, size_t offset);
 
 /**
- * @brief Split the raw request string into the head and the body
- * Split the raw request at \r\n\r\n and return the head.
+ * @brief Get the method of a request line
  *
- * Returns NULL if the raw_request is NULL.
+ * @param method The method token
+ * @return The method, REQUEST_METHOD_UNKNOWN if it is not a HTTP method
+ */
+request_method parse_request_method(str_view method);
+
+/**
+ * @brief Get the version of a request line
  *
- * @param raw_request Raw HTTP request string
- * @return New string with the head
+ * @param version The version token
+ * @return The version, REQUEST_VERSION_UNKNOWN if it is not HTTP/1.0 or HTTP/1.1
+ */
+request_version parse_request_version(str_view version);
+
+/**
+ * @brief Get the known header of a header name
+ *
+ * The name is compared case-insensitively and as a whole (X-Host is not Host). Known names are
+ * found with one lookup in a perfect hash table.
+ *
+ * @param name The header name (without the colon)
+ * @return The header, REQUEST_HEADER_UNKNOWN if the name is not known
+ */
+request_header parse_request_header_name(str_view name);
+
+/**
+ * @brief Get the name of a known header
+ *
+ * @param header The header
+ * @return The lowercase name, NULL if the header is REQUEST_HEADER_UNKNOWN or invalid
+ */
+const char *get_request_header_name(request_header header);
+
+/**
+ * @brief Get the value of a known header of a request view
+ *
+ * Returns the value of the first occurrence without searching the headers, an empty view if the
+ * request does not contain the header.
+ *
+ * @param request The request view
+ * @param header The header
+ * @return The trimmed value (a view into the raw request)
  */
-string *get_request_head(string *raw_request);
+str_view get_request_header(request_view *request, request_header header);
 
 /**
- * @brief Parse the request line of a raw HTTP request string
+ * @brief Parse a raw HTTP request string in place
+ * @warning The fields of the request point into the raw request, nothing is copied
  *
- * Returns EXIT_FAILURE if the raw_request or request is NULL, if memory allocation fails or if the
- * request line is invalid.
+ * Returns EXIT_FAILURE if the raw_request or request is NULL, if it is larger than
+ * HTTP_MAX_REQUEST_SIZE or if the request line is invalid. The raw_request is seen as invalid if it
+ * does not follow the HTTP/1.1 (or 1.0) request format: `METHOD RESOURCE VERSION\r\n`.
+ * The header lines are tokenized in one pass: all of them are kept in request->headers (values
+ * without surrounding spaces) and known names are classified (see get_request_header()). Malformed
+ * header lines (names that are no RFC 9110 token, values with control characters) are skipped.
  *
  * @param raw_request Raw HTTP request string
- * @param request Request object to store the parsed data
- * @return int EXIT_SUCCESS if the request line was parsed successfully, EXIT_FAILURE otherwise
+ * @param request Request view to store the parsed data
+ * @return int EXIT_SUCCESS if the request was parsed successfully, EXIT_FAILURE otherwise
+ */
+int parse_request_view(string *raw_request, request_view *request);
+
+/**
+ * @brief Get a view of a request object
+ * @warning The view points into the fields of the request object
+ *
+ * @param request Request object
+ * @return The request view
  */
-int parse_request_headers(string *raw_request, request_t *request);
+request_view view_request(request_t *request);
 
 /**
  * @brief Parse a raw HTTP request string into a request object
  * @warning The request object must be freed with free_request() after use
+ * @note Compatibility layer for parse_request_view(), the fields are copied
  *
  * Returns NULL if the raw_request is NULL, if memory allocation fails or if the request line is
- * invalid. The raw_request is seen as invalid if it does not follow the HTTP/1.1 (or 1.0) request
- * format: `METHOD RESOURCE VERSION\r\n`. Additionally, it will fail if the headers are not in the
- * format `HEADER: VALUE\r\n`.
+ * invalid (see parse_request_view()).
  *
  * @param raw_request Raw HTTP request string
  * @return request_t* Decoded request object
@@ -81,28 +171,102 @@ int parse_request_headers(string *raw_request, request_t *request);
 request_t *parse_request_string(string *raw_request);
 
 /**
- * @brief Encode a response object into a raw HTTP response string
- * @warning The returned string must be freed with free_string() after use
+ * @brief Encode a response object into a raw HTTP response
+ * @warning The returned response must be freed with free_encoded_response() after use
+ * @warning The body is moved into the encoded response, response->body is NULL afterwards
  *
  * Returns NULL if the response is NULL or if memory allocation fails.
- * The response is encoded in the following format: `VERSION STATUS_CODE STATUS_MESSAGE\r\nHEADER1:
- * VALUE1\r\nHEADER2: VALUE2\r\n...\r\n\r\nBODY`.
+ * The head is encoded in the following format: `VERSION STATUS_CODE STATUS_MESSAGE\r\nHEADER1:
+ * VALUE1\r\nHEADER2: VALUE2\r\n...\r\n\r\n`, the body is kept as a separate segment (not
+ * copied). The Connection header is only added if response->connection is set.
  *
  * @param response Response object to be encoded
- * @return string* Encoded raw HTTP response string
+ * @return encoded_response_t* Encoded raw HTTP response
+ */
+encoded_response_t *encode_response(response_t *response);
+
+/**
+ * @brief Encode the status line and headers of a response except the Connection header
+ * @warning The returned string must be freed after use
+ *
+ * Used to serialize the head of a response that is sent repeatedly (e.g. for a cached file) once,
+ * the head of every response is completed with encode_prepared_response().
+ * Returns NULL if the response is NULL or if memory allocation fails.
+ *
+ * @param response Response object to be encoded
+ * @return The encoded status line and headers (each terminated by a line break)
+ */
+string *encode_response_fields(response_t *response);
+
+/**
+ * @brief Encode a response from a head prepared with encode_response_fields()
+ * @warning The returned response must be freed with free_encoded_response() after use
+ *
+ * The Connection header and the final line break are appended to a copy of the fields, the body is
+ * not set. Returns NULL if the fields are NULL or if memory allocation fails.
+ *
+ * @param fields The encoded status line and headers
+ * @param keep_alive Whether the connection stays open after the response
+ * @param arena The arena the response and its head are allocated from, NULL for the heap
+ * @return encoded_response_t* Encoded raw HTTP response
  */
-string *serialize_response(response_t *response);
+encoded_response_t *encode_prepared_response(string *fields, bool keep_alive, arena *arena);
+
+/**
+ * @brief URL decode a string into a buffer
+ *
+ * Plus signs are decoded as spaces and every `%XX` escape as the byte XX (bytes above 0x7f are kept,
+ * e.g. of a percent encoded UTF-8 character). The decoded string is never longer than the encoded
+ * one, so dest needs room for length bytes and may be src (decoded in place). The decoded string is
+ * not null terminated.
+ *
+ * Returns EXIT_FAILURE if a percent sign is not followed by two hex digits or an escape decodes to
+ * a null byte (the content of dest is undefined in this case).
+ *
+ * @param dest The buffer the decoded string is written to
+ * @param src The string to decode (not null terminated)
+ * @param length The length of the string
+ * @param decoded The length of the decoded string
+ * @return EXIT_SUCCESS if the string has been decoded, EXIT_FAILURE if it is malformed
+ */
+int decode_url_to(char *dest, const char *src, size_t length, size_t *decoded);
+
+/**
+ * @brief URL decode a string in place
+ *
+ * Same as decode_url_to() with the string as buffer.
+ *
+ * @param str The string to decode (not null terminated)
+ * @param length In: the length of the string, out: the length of the decoded string
+ * @return EXIT_SUCCESS if the string has been decoded, EXIT_FAILURE if it is malformed
+ */
+int decode_url_in_place(char *str, size_t *length);
 
 /**
  * @brief URL decode a string
  *
- * Returns NULL if the str is NULL or if memory allocation fails.
+ * Returns NULL if the str is NULL, if it is malformed (see decode_url_to()) or if memory
+ * allocation fails.
  *
  * @param str The string to decode
  * @return string* The decoded string
  */
 string *decode_url(string *str);
 
+/**
+ * @brief URL encode a string into a buffer
+ *
+ * Unreserved characters (RFC 3986) are copied, spaces are encoded as plus signs and all other bytes
+ * as `%XX`. dest needs room for URL_ENCODED_MAX_LENGTH(length) bytes, the encoded string is not
+ * null terminated.
+ *
+ * @param dest The buffer the encoded string is written to
+ * @param src The string to encode
+ * @param length The length of the string
+ * @return The length of the encoded string
+ */
+size_t encode_url_to(char *dest, const char *src, size_t length);
+
 /**
  * @brief URL encode a string
  *
@@ -1,189 +1,342 @@
+#define _GNU_SOURCE
+
 #include "http_router.h"
 #include "../../lib/file_lib/file_lib.h"
 #include "../../main.h"
+#include "../http_parser/http_parser.h"
 #include "../http_server/http_server.h"
+#include <ctype.h>
 #include <errno.h>
-#include <limits.h>
+#include <fcntl.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <unistd.h>
+
+/**
+ * Virtual host, its files are served from a subdirectory of the document root.
+ */
+struct virtual_host {
+  // path of the root directory of the host (relative to the working directory)
+  const char *root;
+  size_t root_length;
+  // directory opened with O_PATH at startup, requested files are resolved beneath it
+  int root_fd;
+} typedef virtual_host;
+
+/**
+ * Virtual hosts with their own document root (the intern host is not served).
+ * @warning The roots are opened once before the worker threads start and only read afterwards
+ */
+static virtual_host virtual_hosts[] = {
+    {DOCUMENT_ROOT ROUTE_DEFAULT_HOST, STR_LITERAL_LEN(DOCUMENT_ROOT ROUTE_DEFAULT_HOST), -1},
+    {DOCUMENT_ROOT ROUTE_EXTERN_HOST, STR_LITERAL_LEN(DOCUMENT_ROOT ROUTE_EXTERN_HOST), -1},
+};
+
+#define VIRTUAL_HOST_DEFAULT (&virtual_hosts[0])
+#define VIRTUAL_HOST_EXTERN (&virtual_hosts[1])
+
+void open_document_roots() {
+  for (size_t i = 0; i < sizeof(virtual_hosts) / sizeof(virtual_hosts[0]); i++) {
+    if (virtual_hosts[i].root_fd >= 0) {
+      continue;
+    }
 
-string *convert_to_absolute_path(string *resource, string *host_extension) {
-  if (resource == NULL) {
-    return NULL;
-  }
+    virtual_hosts[i].root_fd = open(virtual_hosts[i].root, O_PATH | O_DIRECTORY | O_CLOEXEC);
 
-  string *relative_path = _new_string();
-  char *absolute_path = calloc(PATH_MAX, 1);
+    if (virtual_hosts[i].root_fd < 0) {
+      exit_err("open_document_roots", "on open of a document root");
+    }
+  }
+}
 
-  if (absolute_path == NULL) {
-    free_str(relative_path);
-    return NULL;
+void close_document_roots() {
+  for (size_t i = 0; i < sizeof(virtual_hosts) / sizeof(virtual_hosts[0]); i++) {
+    if (virtual_hosts[i].root_fd >= 0) {
+      close(virtual_hosts[i].root_fd);
+      virtual_hosts[i].root_fd = -1;
+    }
   }
+}
 
-  // add document root to relative path
-  str_cat(relative_path, DOCUMENT_ROOT, strlen(DOCUMENT_ROOT));
-  // add host extension to relative path
-  str_cat(relative_path, get_char_str(host_extension), get_length(host_extension));
-  // add resource to relative path
-  str_cat(relative_path, get_char_str(resource), get_length(resource));
+/**
+ * File cache of the calling worker thread, created on first use.
+ */
+static _Thread_local file_cache *router_file_cache = NULL;
+
+/**
+ * @brief Get the file cache of the calling thread
+ *
+ * @return The file cache, NULL if it could not be created
+ */
+static file_cache *get_router_file_cache() {
+  if (router_file_cache == NULL) {
+    router_file_cache =
+        new_file_cache(FILE_CACHE_SIZE, FILE_CACHE_MAX_FILE_SIZE, FILE_CACHE_MAX_DESCRIPTORS,
+                       FILE_CACHE_MAX_NEGATIVES, FILE_CACHE_REVALIDATE_INTERVAL,
+                       FILE_CACHE_NEGATIVE_TTL);
+  }
 
-  char *real_path = realpath(get_char_str(relative_path), absolute_path);
+  return router_file_cache;
+}
 
-  if (real_path == NULL) {
-    free_str(relative_path);
-    free(absolute_path);
-    return NULL;
-  }
+void free_router_file_cache() { free_file_cache(&router_file_cache); }
 
-  free_str(relative_path);
+/**
+ * Failed lookups of all workers that were answered from the file cache (hits) or had to be looked
+ * up in the file system (misses).
+ */
+static atomic_size_t negative_cache_hits = 0;
+static atomic_size_t negative_cache_misses = 0;
 
-  /// @node strlen() is safe to use here - absolute_path is a default char array
-  string *absolute = str_cpy(absolute_path, strlen(absolute_path));
-  free(absolute_path);
-  return absolute;
+void get_negative_cache_stats(size_t *hits, size_t *misses) {
+  *hits = atomic_load_explicit(&negative_cache_hits, memory_order_relaxed);
+  *misses = atomic_load_explicit(&negative_cache_misses, memory_order_relaxed);
 }
 
-bool valid_path(string *path, string *host_extension) {
-  if (path == NULL || host_extension == NULL) {
-    return false;
-  }
+/**
+ * @brief Build the response with the statistics of the server
+ *
+ * @param keep_alive Whether the connection stays open after the response
+ * @return The encoded response
+ */
+static encoded_response_t *stats_response(bool keep_alive) {
+  response_t *response = new_response();
 
-  if (get_length(path) == 0) {
-    return false;
+  if (response == NULL) {
+    return error_response(HTTP_INTERNAL_SERVER_ERROR, keep_alive, NULL);
   }
 
-  if (path->str[0] != '/') {
-    return false;
-  }
+  size_t hits = 0;
+  size_t misses = 0;
+  get_negative_cache_stats(&hits, &misses);
 
-  string *temp = _new_string();
+  char body[256];
+  int length = snprintf(body, sizeof(body),
+                        "negative_cache_hits: %zu\nnegative_cache_misses: %zu\n"
+                        "negative_cache_hit_ratio: %.4f\n",
+                        hits, misses, hits + misses == 0 ? 0.0 : (double)hits / (hits + misses));
 
-  if (temp == NULL) {
-    return false;
-  }
+  generate_response_status(response, HTTP_OK, &STR_LITERAL(CONTENT_TYPE_TEXT));
+  update_response_connection(response, keep_alive);
+  response->body = str_set(response->body, body, length);
+  update_response_content_length(response);
 
-  str_set(temp, DOCUMENT_ROOT, strlen(DOCUMENT_ROOT));
+  encoded_response_t *encoded_response = encode_response(response);
+  free_response(&response);
 
-  // should contain DOCUMENT_ROOT (mainly prevents access to other directories)
-  if (str_str(path, temp) == NULL) {
-    free_str(temp);
-    return false;
-  }
+  return encoded_response;
+}
 
-  str_set(temp, "..", 2);
+/**
+ * @brief Encode the status line and headers of the response for a file
+ *
+ * @param path The path of the file (determines the content type)
+ * @param file_size The size of the file
+ * @return The encoded fields, NULL if memory allocation fails
+ */
+static string *file_response_fields(string *path, size_t file_size) {
+  response_t *response = new_response();
 
-  if (str_str(path, temp) != NULL) {
-    free_str(temp);
-    return false;
+  if (response == NULL) {
+    return NULL;
   }
 
-  free_str(temp);
-
-  return true;
-}
+  string mime_type = get_mime_type(get_char_str(path));
 
-string *serve_file(string *path) {
-  if (path == NULL) {
-    return error_response(HTTP_NOT_FOUND);
-  }
+  generate_response_status(response, HTTP_OK, &mime_type);
+  set_response_content_length(response, file_size);
 
-  string *file_content = read_file(path);
+  string *fields = encode_response_fields(response);
+  free_response(&response);
 
-  if (file_content == NULL) {
-    int error = HTTP_NOT_FOUND;
+  return fields;
+}
 
-    if (errno == EACCES) {
-      error = HTTP_FORBIDDEN;
-    }
+/**
+ * @brief Get the status code of a failed lookup
+ *
+ * @param error The errno of the lookup
+ * @return HTTP_FORBIDDEN if the access is denied, otherwise HTTP_NOT_FOUND
+ */
+static int lookup_error_status(int error) {
+  return error == EACCES ? HTTP_FORBIDDEN : HTTP_NOT_FOUND;
+}
 
-    free_str(file_content);
-    return error_response(error);
+/**
+ * @brief Build the response for a file
+ *
+ * Small files are served from the memory of the file cache of the thread, larger files are sent
+ * from their file descriptor by the connection (kept open in the file cache for the next request).
+ * Files are opened beneath the root of the virtual host, paths that leave the root are answered
+ * like missing files. Failed lookups are remembered by the file cache, repeated requests for them
+ * are answered with the prepared error response without touching the file system. Transient errors
+ * (see is_cacheable_lookup_error()) are answered with HTTP_INTERNAL_SERVER_ERROR and not cached.
+ *
+ * @param host The virtual host
+ * @param path The path of the file (the root of the host followed by the resource, the key of the
+ * file cache)
+ * @param keep_alive Whether the connection stays open after the response
+ * @param arena The arena the response head is allocated from, NULL for the heap
+ * @return The encoded response (an error response if the file can not be served)
+ */
+static encoded_response_t *serve_file(const virtual_host *host, string *path, bool keep_alive,
+                                      arena *arena) {
+  file_cache *cache = get_router_file_cache();
+  file_cache_entry *cached = file_cache_lookup(cache, path);
+  int file_fd = -1;
+  size_t file_size = 0;
+
+  // a remembered failed lookup is answered with the prepared error response
+  if (cached != NULL && cached->error != 0) {
+    int status_code = lookup_error_status(cached->error);
+
+    release_file_cache_entry(&cached);
+    atomic_fetch_add_explicit(&negative_cache_hits, 1, memory_order_relaxed);
+
+    return error_response(status_code, keep_alive, arena);
   }
 
-  response_t *response = new_response();
+  if (cached == NULL) {
+    // the resource is resolved relative to the root directory of the host
+    const char *relative = get_char_str(path) + host->root_length;
 
-  if (response == NULL) {
-    free_str(file_content);
-    return error_response(HTTP_INTERNAL_SERVER_ERROR);
-  }
+    while (*relative == '/') {
+      relative++;
+    }
 
-  string *mime_type = get_mime_type(get_char_str(path));
+    file_fd = open_file_beneath(host->root_fd, relative, &file_size);
 
-  generate_response_status(response, HTTP_OK, mime_type);
-  free_str(mime_type);
+    // a path that leaves the root (EXDEV) does not reveal whether the file exists
+    if (file_fd < 0) {
+      int error = errno;
 
-  response->body = str_set(response->body, get_char_str(file_content), get_length(file_content));
-  free_str(file_content);
+      // transient errors (EMFILE, ENOMEM, ...) are neither cached nor counted as misses
+      if (!is_cacheable_lookup_error(error)) {
+        return error_response(HTTP_INTERNAL_SERVER_ERROR, keep_alive, arena);
+      }
 
-  update_response_content_length(response);
+      atomic_fetch_add_explicit(&negative_cache_misses, 1, memory_order_relaxed);
 
-  string *encoded_response = serialize_response(response);
+      // the failed lookup is remembered, repeated requests do not touch the file system
+      cached = file_cache_insert_negative(cache, path, error);
+      release_file_cache_entry(&cached);
 
-  free_response(&response);
-  return encoded_response;
-}
+      return error_response(lookup_error_status(error), keep_alive, arena);
+    } else if (cache != NULL && file_size <= cache->max_file_size) {
+      // small files are kept in memory together with their encoded headers
+      cached = file_cache_insert(cache, path, file_fd, file_response_fields(path, file_size));
+
+      if (cached != NULL) {
+        close(file_fd);
+      }
+    } else if (cache != NULL) {
+      // larger files stay open, the cache owns the file descriptor
+      cached = file_cache_insert_descriptor(cache, path, file_fd,
+                                            file_response_fields(path, file_size));
+    }
 
-string *route_request(request_t *request) {
-  if (str_cmp(request->resource, ROUTE_DEBUG) == 0) {
-    // no cleanup needed, debug_response() will free the request
-    return debug_response(request);
+    if (cached != NULL) {
+      file_fd = -1;
+    }
   }
 
-  string *host = request->host;
-  string *path_extension = NULL;
+  encoded_response_t *encoded_response = NULL;
 
-  if (host == NULL) {
-    path_extension = str_cpy(ROUTE_DEFAULT_HOST, strlen(ROUTE_DEFAULT_HOST));
-  } else {
-    // Split host header on ':'
-    string *new_host = _new_string();
+  if (cached != NULL) {
+    // the head is completed from the cached fields and the content is sent from the cache
+    encoded_response = encode_prepared_response(cached->header, keep_alive, arena);
+
+    if (encoded_response != NULL) {
+      encoded_response->cached = cached;
 
-    for (int i = 0; i < get_length(host); i++) {
-      if (host->str[i] == ':') {
-        break;
+      // the body is sent from the file descriptor of the entry (it is not closed by the response)
+      if (cached->fd >= 0) {
+        encoded_response->file_fd = cached->fd;
+        encoded_response->file_length = cached->size;
       }
 
-      str_cat(new_host, &host->str[i], 1);
+      return encoded_response;
     }
 
-    str_set(host, get_char_str(new_host), get_length(new_host));
-    free_str(new_host);
+    release_file_cache_entry(&cached);
+  } else {
+    string *fields = file_response_fields(path, file_size);
+    encoded_response = encode_prepared_response(fields, keep_alive, arena);
+    free_str(fields);
+
+    // the body is not read, it is sent from the file by the connection
+    if (encoded_response != NULL) {
+      encoded_response->file_fd = file_fd;
+      encoded_response->file_length = file_size;
+      return encoded_response;
+    }
+
+    close(file_fd);
   }
 
-  str_to_lower(host);
+  return error_response(HTTP_INTERNAL_SERVER_ERROR, keep_alive, arena);
+}
+
+/**
+ * @brief Check if the Host header names a host
+ *
+ * Spaces inside the header value and the port are ignored, the host is compared case-insensitive.
+ *
+ * @param host The value of the Host header
+ * @param name The host name (lower case, null terminated)
+ * @return true if the header names the host
+ */
+static bool host_matches(str_view host, const char *name) {
+  size_t matched = 0;
+
+  for (size_t i = 0; i < host.len && host.str[i] != ':'; i++) {
+    if (isspace((unsigned char)host.str[i])) {
+      continue;
+    }
+
+    if (name[matched] == '\0' || tolower((unsigned char)host.str[i]) != name[matched]) {
+      return false;
+    }
 
-  if (str_cmp(host, HOST_EXTERN) == 0) {
-    path_extension = str_cpy(ROUTE_EXTERN_HOST, strlen(ROUTE_EXTERN_HOST));
+    matched++;
   }
 
-  if (str_cmp(host, HOST_INTERN) == 0) {
-    free_request(&request);
-    free_str(path_extension);
-    return error_response(HTTP_UNAUTHORIZED);
+  return name[matched] == '\0';
+}
+
+encoded_response_t *route_request(request_view *request, arena *arena) {
+  if (str_view_equal(request->resource, STR_VIEW_LITERAL(ROUTE_DEBUG))) {
+    return debug_view_response(request);
   }
 
-  if (path_extension == NULL) {
-    path_extension = str_cpy(ROUTE_DEFAULT_HOST, strlen(ROUTE_DEFAULT_HOST));
+  if (str_view_equal(request->resource, STR_VIEW_LITERAL(ROUTE_STATS))) {
+    return stats_response(request->keep_alive);
   }
 
-  string *path = convert_to_absolute_path(request->resource, path_extension);
+  bool keep_alive = request->keep_alive;
+  str_view host = get_request_header(request, REQUEST_HEADER_HOST);
 
-  if (path == NULL) {
-    free_request(&request);
-    free_str(path_extension);
-    return error_response(HTTP_NOT_FOUND);
+  if (host_matches(host, HOST_INTERN)) {
+    return error_response(HTTP_UNAUTHORIZED, keep_alive, arena);
   }
 
-  if (!valid_path(path, path_extension)) {
-    free_request(&request);
-    free_str(path);
-    free_str(path_extension);
-    return error_response(HTTP_FORBIDDEN);
+  const virtual_host *served_host = VIRTUAL_HOST_DEFAULT;
+
+  if (host_matches(host, HOST_EXTERN)) {
+    served_host = VIRTUAL_HOST_EXTERN;
   }
 
-  string *response = serve_file(path);
+  // the unresolved path is the key of the file cache, it is only resolved if the file is not cached
+  string *path = new_string_arena(arena);
+  str_cat_arena(arena, path, served_host->root, served_host->root_length);
+  str_cat_arena(arena, path, request->resource.str, request->resource.len);
 
-  free_str(path);
-  free_str(path_extension);
-  free_request(&request);
+  encoded_response_t *response = serve_file(served_host, path, keep_alive, arena);
+
+  // a path of the arena is released together with the response
+  if (arena == NULL) {
+    free_str(path);
+  }
 
   return response;
-}
\ No newline at end of file
+}
@@ -5,42 +5,56 @@
 #include <stdbool.h>
 
 /**
- * @brief Converts a relative path to an absolute path
+ * @brief Open the root directories of the virtual hosts
+ * @warning Has to be called once before requests are routed (before the worker threads start)
  *
- * The absolute path is determined by the document root, host extension and resource.
- * The document root is the root directory of the server.
- * Returns NULL if the resource is NULL or the absolute path could not be resolved.
- *
- * @param resource the resource requested by the client
- * @param host_extension the subdirectory after the document root
- * @return string* of the absolute path
+ * Every root (DOCUMENT_ROOT followed by the host extension) is opened with O_PATH, the requested
+ * files are resolved beneath it by the kernel (see open_file_beneath()).
+ * Exits with error if a root directory could not be opened.
  */
-string *convert_to_absolute_path(string *resource, string *host_extension);
+void open_document_roots();
 
 /**
- * @brief Checks if the path is valid
- *
- * A path is valid if it is not NULL and the host extension is not NULL (Both must be longer than
- * 0).
- *
- * @param path the path to check
- * @param host_extension the host extension to check
- * @return true if the path is valid, false otherwise
+ * @brief Close the root directories of the virtual hosts
  */
-bool valid_path(string *path, string *host_extension);
+void close_document_roots();
 
 /**
  * @brief Routes the request to the correct path
  * @warning will return a fully qualified HTTP response (either if the request is valid or not)
- * @warning will free the request object
  *
  * The path is determined by the host and the resource.
  * If the host is NULL or does not match any of the predefined hosts,
  * the default folder is returned.
+ * The file cache of the thread is keyed by the unresolved path (root of the host and decoded
+ * resource), so a hit is answered without resolving the path again. The path is only resolved
+ * (openat2() beneath the root) on a miss and checked with stat() once the revalidation interval
+ * (FILE_CACHE_REVALIDATE_INTERVAL) has passed.
+ *
+ * @param request the parsed request
+ * @param arena the arena of the request (temporary strings and the response head), NULL for the heap
+ * @return Encoded raw HTTP response
+ */
+encoded_response_t *route_request(request_view *request, arena *arena);
+
+/**
+ * @brief Get the statistics of the negative cache of all workers
+ *
+ * A hit is a request for a missing or forbidden file that has been answered from a remembered
+ * failed lookup (see FILE_CACHE_MAX_NEGATIVES), a miss is a failed lookup in the file system. The
+ * statistics are also served on ROUTE_STATS.
+ *
+ * @param hits Set to the number of hits
+ * @param misses Set to the number of misses
+ */
+void get_negative_cache_stats(size_t *hits, size_t *misses);
+
+/**
+ * @brief Free the file cache of the calling thread
  *
- * @param request the request object
- * @return string* of the absolute path
+ * Every thread that routes requests keeps the small files it served in its own cache (see
+ * FILE_CACHE_SIZE), a worker frees its cache once it stopped.
  */
-string *route_request(request_t *request);
+void free_router_file_cache();
 
 #endif
@@ -1,82 +1,72 @@
 #include "http_server.h"
+#include "../../main.h"
 #include "../http_router/http_router.h"
 #include "request_validation/request_validation.h"
+#include <pthread.h>
 #include <unistd.h>
 
-string *get_mime_type(const char *path) {
+string get_mime_type(const char *path) {
+  // default mime type: text/plain
   if (path == NULL) {
-    return NULL;
-  }
-
-  string *mime_type = _new_string();
-
-  if (mime_type == NULL) {
-    return NULL;
+    return STR_LITERAL(CONTENT_TYPE_TEXT);
   }
 
-  // default mime type: text/plain
-  str_set(mime_type, CONTENT_TYPE_TEXT, strlen(CONTENT_TYPE_TEXT));
-
   /// @node strrchr() is safe here - path is a string literal
   const char *extension = strrchr(path, '.');
 
   if (extension == NULL) {
-    return mime_type;
+    return STR_LITERAL(CONTENT_TYPE_TEXT);
   }
 
   /// @node strncmp() is safe here - extension is a string literal, CONTENT_TYPE_* are constants
   /// defined in http_server.h
   if (strcmp(extension, EXTENSION_HTML) == 0) {
-    str_set(mime_type, CONTENT_TYPE_HTML, strlen(CONTENT_TYPE_HTML));
-    return mime_type;
+    return STR_LITERAL(CONTENT_TYPE_HTML);
   }
 
   if (strcmp(extension, EXTENSION_CSS) == 0) {
-    str_set(mime_type, CONTENT_TYPE_CSS, strlen(CONTENT_TYPE_CSS));
-    return mime_type;
+    return STR_LITERAL(CONTENT_TYPE_CSS);
   }
 
   if (strcmp(extension, EXTENSION_JS) == 0) {
-    str_set(mime_type, CONTENT_TYPE_JS, strlen(CONTENT_TYPE_JS));
-    return mime_type;
+    return STR_LITERAL(CONTENT_TYPE_JS);
   }
 
   if (strcmp(extension, EXTENSION_JPG) == 0 || strcmp(extension, EXTENSION_JPEG) == 0) {
-    str_set(mime_type, CONTENT_TYPE_JPEG, strlen(CONTENT_TYPE_JPEG));
-    return mime_type;
+    return STR_LITERAL(CONTENT_TYPE_JPEG);
   }
 
   if (strcmp(extension, EXTENSION_PNG) == 0) {
-    str_set(mime_type, CONTENT_TYPE_PNG, strlen(CONTENT_TYPE_PNG));
-    return mime_type;
+    return STR_LITERAL(CONTENT_TYPE_PNG);
   }
 
   if (strcmp(extension, EXTENSION_ICO) == 0) {
-    str_set(mime_type, CONTENT_TYPE_ICO, strlen(CONTENT_TYPE_ICO));
-    return mime_type;
+    return STR_LITERAL(CONTENT_TYPE_ICO);
   }
 
-  return mime_type;
+  return STR_LITERAL(CONTENT_TYPE_TEXT);
 }
 
-string *error_response(int status_code) {
+/**
+ * @brief Create the response object of an error response (without the Connection header)
+ *
+ * @param status_code HTTP status code
+ * @return The response, NULL if memory allocation fails
+ */
+static response_t *new_error_response(int status_code) {
   response_t *response = new_response();
 
   if (response == NULL) {
     return NULL;
   }
 
-  string *content_type = str_cpy(CONTENT_TYPE_HTML, strlen(CONTENT_TYPE_HTML));
-  generate_response_status(response, status_code, content_type);
-  free_str(content_type);
+  generate_response_status(response, status_code, &STR_LITERAL(CONTENT_TYPE_HTML));
 
-  string *status_code_str = int_to_string(status_code);
   const char *status_message = get_http_status_message(status_code);
 
+  // the status code is already part of the response
   response->body = str_set(response->body, "<html><head><title>Error</title></head><body><h1>", 49);
-  str_cat(response->body, get_char_str(status_code_str), get_length(status_code_str));
-
-  free_str(status_code_str);
+  str_cat(response->body, get_char_str(response->status_code), get_length(response->status_code));
 
   str_cat(response->body, "</h1><p>", 8);
   /// @node strlen() is safe here - status_message is a constant defined in http_server.h
@@ -85,50 +75,162 @@ string *error_response(int status_code) {
 
   update_response_content_length(response);
 
-  string *encoded_response = serialize_response(response);
+  return response;
+}
 
-  free_response(&response);
+/**
+ * Error response that is serialized once (see init_error_responses()), the heads for a closed and a
+ * kept alive connection share the body.
+ */
+struct prepared_error_response {
+  int status_code;
+  // indexed by keep_alive
+  string *heads[2];
+  string *body;
+} typedef prepared_error_response;
+
+/**
+ * Every error response the server sends.
+ * @warning The table is built once and only read afterwards
+ */
+static prepared_error_response prepared_error_responses[] = {
+    {.status_code = HTTP_BAD_REQUEST},
+    {.status_code = HTTP_UNAUTHORIZED},
+    {.status_code = HTTP_FORBIDDEN},
+    {.status_code = HTTP_NOT_FOUND},
+    {.status_code = HTTP_REQUEST_HEADER_FIELDS_TOO_LARGE},
+    {.status_code = HTTP_INTERNAL_SERVER_ERROR},
+    {.status_code = HTTP_NOT_IMPLEMENTED},
+    {.status_code = HTTP_VERSION_NOT_SUPPORTED},
+};
+
+static pthread_once_t prepared_error_responses_once = PTHREAD_ONCE_INIT;
+
+/**
+ * @brief Serialize every error response of the table
+ *
+ * Exits with error if memory allocation fails.
+ */
+static void prepare_error_responses() {
+  for (size_t i = 0; i < sizeof(prepared_error_responses) / sizeof(prepared_error_responses[0]);
+       i++) {
+    prepared_error_response *prepared = &prepared_error_responses[i];
+
+    for (int keep_alive = 0; keep_alive < 2; keep_alive++) {
+      response_t *response = new_error_response(prepared->status_code);
+
+      if (response == NULL) {
+        exit_err("prepare_error_responses", "on new_error_response");
+      }
+
+      update_response_connection(response, keep_alive);
+      encoded_response_t *encoded_response = encode_response(response);
+      free_response(&response);
+
+      if (encoded_response == NULL) {
+        exit_err("prepare_error_responses", "on encode_response");
+      }
+
+      // the head and the body are taken over, not copied
+      prepared->heads[keep_alive] = encoded_response->head;
+      encoded_response->head = NULL;
+
+      if (prepared->body == NULL) {
+        prepared->body = encoded_response->body;
+        encoded_response->body = NULL;
+      }
+
+      free_encoded_response(&encoded_response);
+    }
+  }
+}
+
+void init_error_responses() {
+  pthread_once(&prepared_error_responses_once, prepare_error_responses);
+}
+
+encoded_response_t *error_response(int status_code, bool keep_alive, arena *arena) {
+  init_error_responses();
+
+  prepared_error_response *prepared = NULL;
+
+  for (size_t i = 0; i < sizeof(prepared_error_responses) / sizeof(prepared_error_responses[0]);
+       i++) {
+    if (prepared_error_responses[i].status_code == status_code) {
+      prepared = &prepared_error_responses[i];
+      break;
+    }
+  }
+
+  // status codes without a prepared response are serialized on demand
+  if (prepared == NULL) {
+    response_t *response = new_error_response(status_code);
+
+    if (response == NULL) {
+      return NULL;
+    }
+
+    update_response_connection(response, keep_alive);
+    encoded_response_t *encoded_response = encode_response(response);
+    free_response(&response);
+
+    return encoded_response;
+  }
+
+  encoded_response_t *encoded_response = new_encoded_response_arena(arena);
+
+  if (encoded_response == NULL) {
+    return NULL;
+  }
+
+  // the response only points to the prepared head and body, nothing is copied
+  string *head = prepared->heads[keep_alive];
+  str_borrow(encoded_response->head, head->str, head->len);
+  encoded_response->body = str_borrow_arena(arena, prepared->body->str, prepared->body->len);
 
   return encoded_response;
 }
 
-string *debug_response(request_t *request) {
+encoded_response_t *debug_view_response(request_view *request) {
   response_t *response = new_response();
 
   if (response == NULL) {
-    free_request(&request);
-    return error_response(HTTP_INTERNAL_SERVER_ERROR);
+    return error_response(HTTP_INTERNAL_SERVER_ERROR, request->keep_alive, NULL);
   }
 
-  string *content_type = str_cpy(CONTENT_TYPE_HTML, strlen(CONTENT_TYPE_HTML));
-  generate_response_status(response, HTTP_OK, content_type);
-  free_str(content_type);
+  generate_response_status(response, HTTP_OK, &STR_LITERAL(CONTENT_TYPE_HTML));
+  update_response_connection(response, request->keep_alive);
 
   // HTML body
   response->body = str_set(response->body, "<html><head><title>Debug</title></head><body>", 45);
   response->body = str_cat(response->body, "<p>HTTP-Methode: ", 17);
-  response->body =
-      str_cat(response->body, get_char_str(request->method), get_length(request->method));
+  response->body = str_cat(response->body, request->method.str, request->method.len);
 
   response->body = str_cat(response->body, "<br>Ressource: ", 15);
-  response->body =
-      str_cat(response->body, get_char_str(request->resource), get_length(request->resource));
+  response->body = str_cat(response->body, request->resource.str, request->resource.len);
 
   response->body = str_cat(response->body, "<br>HTTP-Version: ", 18);
-  response->body =
-      str_cat(response->body, get_char_str(request->version), get_length(request->version));
+  response->body = str_cat(response->body, request->version.str, request->version.len);
   response->body = str_cat(response->body, "</p></body></html>", 18);
 
   update_response_content_length(response);
 
-  string *encoded_response = serialize_response(response);
+  encoded_response_t *encoded_response = encode_response(response);
 
   free_response(&response);
-  free_request(&request);
 
   return encoded_response;
 }
 
+encoded_response_t *debug_response(request_t *request) {
+  request_view view = view_request(request);
+  encoded_response_t *response = debug_view_response(&view);
+
+  free_request(&request);
+
+  return response;
+}
+
 const char *get_http_status_message(int status_code) {
   // List of HTTP status codes:
   // https://en.wikipedia.org/wiki/List_of_HTTP_status_codes
@@ -143,6 +245,8 @@ const char *get_http_status_message(int status_code) {
     return STATUS_MESSAGE_FORBIDDEN;
   case HTTP_NOT_FOUND:
     return STATUS_MESSAGE_NOT_FOUND;
+  case HTTP_REQUEST_HEADER_FIELDS_TOO_LARGE:
+    return STATUS_MESSAGE_REQUEST_HEADER_FIELDS_TOO_LARGE;
   case HTTP_INTERNAL_SERVER_ERROR:
     return STATUS_MESSAGE_INTERNAL_SERVER_ERROR;
   case HTTP_NOT_IMPLEMENTED:
@@ -154,45 +258,54 @@ const char *get_http_status_message(int status_code) {
   }
 }
 
-string *http_server(string *raw_request) {
-  request_t *decoded_request = parse_request_string(raw_request);
-
-  if (decoded_request == NULL) {
-    return error_response(HTTP_BAD_REQUEST);
+encoded_response_t *http_server(string *raw_request, bool *keep_alive, arena *arena) {
+  // the rest of an oversized request is not read, so the connection can not be reused
+  if (get_length(raw_request) > HTTP_MAX_REQUEST_SIZE) {
+    *keep_alive = false;
+    return error_response(HTTP_REQUEST_HEADER_FIELDS_TOO_LARGE, false, arena);
   }
 
-  string *decoded = decode_url(decoded_request->resource);
+  // the request is parsed in place, its fields point into the raw request
+  request_view request;
+
+  if (parse_request_view(raw_request, &request) == EXIT_FAILURE || request_view_empty(&request)) {
+    *keep_alive = false;
+    return error_response(HTTP_BAD_REQUEST, false, arena);
+  }
 
-  if (decoded == NULL) {
-    free_request(&decoded_request);
-    return error_response(HTTP_BAD_REQUEST);
+  if (request.header_overflow) {
+    *keep_alive = false;
+    return error_response(HTTP_REQUEST_HEADER_FIELDS_TOO_LARGE, false, arena);
   }
 
-  // free old resource and set new decoded resource
-  str_set(decoded_request->resource, get_char_str(decoded), get_length(decoded));
-  free_str(decoded);
+  // the resource is decoded in place (the raw request is not used afterwards)
+  char *resource = raw_request->str + (request.resource.str - raw_request->str);
 
-  if (request_empty(decoded_request)) {
-    free_request(&decoded_request);
-    return error_response(HTTP_BAD_REQUEST);
+  if (decode_url_in_place(resource, &request.resource.len) == EXIT_FAILURE) {
+    *keep_alive = false;
+    return error_response(HTTP_BAD_REQUEST, false, arena);
   }
 
-  if (!supported_version(decoded_request->version)) {
-    free_request(&decoded_request);
-    return error_response(HTTP_VERSION_NOT_SUPPORTED);
+  if (request.version_id == REQUEST_VERSION_UNKNOWN) {
+    *keep_alive = false;
+    return error_response(HTTP_VERSION_NOT_SUPPORTED, false, arena);
   }
 
-  if (!supported_method(decoded_request->method)) {
-    free_request(&decoded_request);
-    return error_response(HTTP_NOT_IMPLEMENTED);
+  // the request body of unsupported methods is not read, so the connection can not be reused
+  if (!supported_request_method(request.method_id)) {
+    *keep_alive = false;
+    return error_response(HTTP_NOT_IMPLEMENTED, false, arena);
   }
 
-  string *response = route_request(decoded_request);
+  *keep_alive = *keep_alive && request_view_keep_alive(&request);
+  request.keep_alive = *keep_alive;
+
+  encoded_response_t *response = route_request(&request, arena);
 
   if (response == NULL) {
-    free_request(&decoded_request);
-    return error_response(HTTP_INTERNAL_SERVER_ERROR);
+    *keep_alive = false;
+    return error_response(HTTP_INTERNAL_SERVER_ERROR, false, arena);
   }
 
   return response;
-}
\ No newline at end of file
+}
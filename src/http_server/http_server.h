@@ -26,6 +26,7 @@
 #define HTTP_UNAUTHORIZED 401
 #define HTTP_FORBIDDEN 403
 #define HTTP_NOT_FOUND 404
+#define HTTP_REQUEST_HEADER_FIELDS_TOO_LARGE 431
 #define HTTP_INTERNAL_SERVER_ERROR 500
 #define HTTP_NOT_IMPLEMENTED 501
 #define HTTP_VERSION_NOT_SUPPORTED 505
@@ -36,6 +37,7 @@
 #define STATUS_MESSAGE_UNAUTHORIZED "Authentication required"
 #define STATUS_MESSAGE_FORBIDDEN "Forbidden"
 #define STATUS_MESSAGE_NOT_FOUND "Not Found"
+#define STATUS_MESSAGE_REQUEST_HEADER_FIELDS_TOO_LARGE "Request Header Fields Too Large"
 #define STATUS_MESSAGE_INTERNAL_SERVER_ERROR "Internal Server Error"
 #define STATUS_MESSAGE_NOT_IMPLEMENTED "Not Implemented"
 #define STATUS_MESSAGE_VERSION_NOT_SUPPORTED "HTTP Version Not Supported"
@@ -46,9 +48,14 @@
 #define CONTENT_TYPE_HEADER "Content-Type: "
 #define WWW_AUTHENTICATE_HEADER "WWW-Authenticate: "
 #define SERVER_HEADER "Server: "
+#define CONNECTION_HEADER "Connection: "
 
 #define WWW_AUTHENTICATE_REALM "Basic realm=\"Secure Area\""
 
+// HTTP Connection options
+#define CONNECTION_KEEP_ALIVE "keep-alive"
+#define CONNECTION_CLOSE "close"
+
 // File extensions
 #define EXTENSION_HTML ".html"
 #define EXTENSION_CSS ".css"
@@ -63,35 +70,59 @@
  * @warning path should not be a struct string
  *
  * The mime type is determined by the file extension.
- * If the file extension is not known, the default mime type is text/plain.
+ * If the file extension is not known (or path is NULL), the default mime type is text/plain.
+ * The mime type is a static string (see STR_LITERAL()), it is not allocated and must not be freed.
  *
  * @param path Path to the file (constant string - null terminated)
  * @return Mime type of the file
  */
-string *get_mime_type(const char *path);
+string get_mime_type(const char *path);
+
+/**
+ * @brief Serialize the error responses of the server
+ *
+ * Every error response the server sends (status line, headers and body, for a closed and a kept
+ * alive connection) is serialized once into an immutable table. Called at startup, later calls do
+ * nothing (it is also called by the first error_response()).
+ * Exits with error if memory allocation fails.
+ */
+void init_error_responses();
 
 /**
  * @brief Create an error response for a given status code
  *
- * The error response is created by generating a response object with the given status code.
  * The body of the response contains a simple HTML error message.
+ * The head and the body point to the prepared response of the status code (see
+ * init_error_responses()), only the response itself is allocated. Status codes without a prepared
+ * response are serialized on demand.
  *
  * @param status_code HTTP status code
- * @return Encoded raw HTTP response string
+ * @param keep_alive Whether the connection stays open after the response
+ * @param arena The arena the response is allocated from, NULL for the heap
+ * @return Encoded raw HTTP response
  */
-string *error_response(int status_code);
+encoded_response_t *error_response(int status_code, bool keep_alive, arena *arena);
 
 /**
  * @brief Create a debug_route response for a given request
- * @warning This function will free the given request object
  *
  * The debug_route response is created by generating a response object with the status code 200.
  * The body of the response contains the HTTP method, resource and version of the request.
  *
+ * @param request Request to be debugged
+ * @return Encoded raw HTTP response
+ */
+encoded_response_t *debug_view_response(request_view *request);
+
+/**
+ * @brief Create a debug_route response for a given request object
+ * @warning This function will free the given request object
+ * @note Compatibility layer for debug_view_response()
+ *
  * @param request Request object to be debugged
- * @return Encoded raw HTTP response string
+ * @return Encoded raw HTTP response
  */
-string *debug_response(request_t *request);
+encoded_response_t *debug_response(request_t *request);
 
 /**
  * @brief Get HTTP status message for a given status code
@@ -113,11 +144,20 @@ const char *get_http_status_message(int status_code);
  * implemented. If the requested resource is "/debug_route", the function will return a debug_route
  * response. If the requested resource is not found, the function will return a 404 response. If the
  * requested resource is forbidden, the function will return a 403 response. If the requested
- * resource cannot be accessed, the function will return a 500 response.
+ * resource cannot be accessed, the function will return a 500 response. Requests larger than
+ * HTTP_MAX_REQUEST_SIZE are rejected with a 431 response before they are parsed, requests with more
+ * than REQUEST_MAX_HEADERS header lines after they are parsed.
+ *
+ * keep_alive has to be set by the caller to whether the connection may stay open after this
+ * request. It is updated to whether the connection actually stays open: HTTP/1.1 connections are
+ * persistent unless the client sends `Connection: close`, HTTP/1.0 connections only with
+ * `Connection: keep-alive`. Invalid requests always close the connection.
  *
- * @param raw_request Raw HTTP request string
- * @return Encoded raw HTTP response string
+ * @param raw_request Raw HTTP request string (parsed in place, the resource is decoded in place)
+ * @param keep_alive In: the connection may stay open, out: the connection stays open
+ * @param arena Arena the response head and temporary strings are allocated from, NULL for the heap
+ * @return Encoded raw HTTP response
  */
-string *http_server(string *request);
+encoded_response_t *http_server(string *request, bool *keep_alive, arena *arena);
 
 #endif
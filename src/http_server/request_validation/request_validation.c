@@ -1,14 +1,75 @@
 #include "request_validation.h"
+#include "../../http_parser/http_parser.h"
 #include "../http_server.h"
 
+bool request_view_empty(request_view *request) {
+  return request->method.len == 0 || request->resource.len == 0 || request->version.len == 0;
+}
+
 bool request_empty(request_t *request) {
-  return request->method == NULL || request->resource == NULL || request->version == NULL ||
-         get_length(request->method) == 0 || get_length(request->resource) == 0 ||
-         get_length(request->version) == 0;
+  if (request->method == NULL || request->resource == NULL || request->version == NULL) {
+    return true;
+  }
+
+  request_view view = view_request(request);
+
+  return request_view_empty(&view);
 }
 
 bool supported_version(string *version) {
-  return str_cmp(version, HTTP_VERSION_1_0) == 0 || str_cmp(version, HTTP_VERSION_1_1) == 0;
+  return parse_request_version(str_view_of(version)) != REQUEST_VERSION_UNKNOWN;
+}
+
+bool supported_method(string *method) {
+  return supported_request_method(parse_request_method(str_view_of(method)));
 }
 
-bool supported_method(string *method) { return str_cmp(method, HTTP_METHOD_GET) == 0; }
\ No newline at end of file
+bool supported_request_method(request_method method) { return method == REQUEST_METHOD_GET; }
+
+/**
+ * @brief Check if a comma separated Connection header contains an option (case-insensitive)
+ *
+ * @param connection The value of the Connection header
+ * @param option The option to search for (string constant - null terminated)
+ * @return true if the option is part of the header
+ */
+static bool connection_has_option(str_view connection, const char *option) {
+  size_t start = 0;
+
+  for (size_t i = 0; i <= connection.len; i++) {
+    if (i < connection.len && connection.str[i] != ',') {
+      continue;
+    }
+
+    // options may be surrounded by spaces
+    str_view current = {.str = connection.str + start, .len = i - start};
+
+    if (str_view_case_cmp(str_view_trim(current), option) == 0) {
+      return true;
+    }
+
+    start = i + 1;
+  }
+
+  return false;
+}
+
+bool request_view_keep_alive(request_view *request) {
+  str_view connection = get_request_header(request, REQUEST_HEADER_CONNECTION);
+
+  if (request->version_id == REQUEST_VERSION_1_1) {
+    return !connection_has_option(connection, CONNECTION_CLOSE);
+  }
+
+  if (request->version_id == REQUEST_VERSION_1_0) {
+    return connection_has_option(connection, CONNECTION_KEEP_ALIVE);
+  }
+
+  return false;
+}
+
+bool request_keep_alive(request_t *request) {
+  request_view view = view_request(request);
+
+  return request_view_keep_alive(&view);
+}
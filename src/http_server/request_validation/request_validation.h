@@ -4,13 +4,24 @@
 #include "../../http_models/http_models.h"
 #include <stdbool.h>
 
+/**
+ * @brief Check if the request view contains all necessary information
+ *
+ * The request must contain a method, a resource and a version which cannot be empty.
+ *
+ * @param request
+ * @return true if the request is missing necessary information
+ */
+bool request_view_empty(request_view *request);
+
 /**
  * @brief Check if the request contains all necessary information
+ * @note Compatibility layer for request_view_empty()
  *
  * The request must contain a method, a resource and a version which cannot be null or empty.
  *
  * @param request
- * @return true if the request contains all necessary information
+ * @return true if the request is missing necessary information
  */
 bool request_empty(request_t *request);
 
@@ -34,4 +45,33 @@ bool supported_version(string *version);
  */
 bool supported_method(string *method);
 
+/**
+ * @brief Check if the method of a parsed request is supported
+ *
+ * @param method
+ * @return true if the method is GET
+ */
+bool supported_request_method(request_method method);
+
+/**
+ * @brief Check if the client wants to keep the connection open after the response
+ *
+ * HTTP/1.1 connections are persistent unless the Connection header contains "close". HTTP/1.0
+ * connections are only persistent if the Connection header contains "keep-alive". The options of
+ * the Connection header are compared case-insensitive.
+ *
+ * @param request
+ * @return true if the connection should stay open
+ */
+bool request_view_keep_alive(request_view *request);
+
+/**
+ * @brief Check if the client wants to keep the connection open after the response
+ * @note Compatibility layer for request_view_keep_alive()
+ *
+ * @param request
+ * @return true if the connection should stay open
+ */
+bool request_keep_alive(request_t *request);
+
 #endif
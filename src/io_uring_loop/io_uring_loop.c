@@ -0,0 +1,784 @@
+#define _GNU_SOURCE
+
+#include "io_uring_loop.h"
+#include "../../main.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <poll.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+/**
+ * Interval in milliseconds in which idle connections are checked.
+ */
+#define IO_URING_TIMEOUT_MS 1000
+
+/// operations are stored in the lower bits of the user_data, the upper bits hold the connection
+enum uring_operation {
+  URING_ACCEPT = 1,
+  URING_RECV,
+  URING_SEND,
+  URING_CANCEL,
+  URING_WAKE,
+  URING_TIMEOUT,
+  URING_SPLICE
+} typedef uring_operation;
+
+#define URING_OPERATION_MASK 7
+
+struct uring {
+  int fd;
+  unsigned *sq_head;
+  unsigned *sq_tail;
+  unsigned *sq_array;
+  unsigned sq_mask;
+  unsigned sq_entries;
+  unsigned sq_local_tail;
+  unsigned to_submit;
+  unsigned *cq_head;
+  unsigned *cq_tail;
+  unsigned cq_mask;
+  struct io_uring_sqe *sqes;
+  struct io_uring_cqe *cqes;
+  void *ring_ptr;
+  size_t ring_size;
+  size_t sqes_size;
+  struct io_uring_buf_ring *buffer_ring;
+  size_t buffer_ring_size;
+  unsigned short buffer_tail;
+  char *buffers;
+} typedef uring;
+
+struct uring_server {
+  uring ring;
+  int sock_fd;
+  int wake_fd;
+  request_handler handler;
+  buffer_pool *pool;
+  time_t now;
+  connection_list connections;
+  // whether the multishot accept is armed (it is armed again with a delay after an error)
+  bool accept_armed;
+  // a recv ended because all provided buffers were in use, recvs are armed again once the handled
+  // completions have returned their buffers
+  bool recv_starved;
+  // closed connections that still wait for submitted operations to complete
+  connection_list closing;
+  struct __kernel_timespec timeout;
+} typedef uring_server;
+
+/**
+ * @brief Return a provided receive buffer to the kernel
+ *
+ * @param ring The ring
+ * @param buffer_id The id of the buffer
+ */
+static void provide_buffer(uring *ring, unsigned short buffer_id) {
+  struct io_uring_buf *buffer =
+      &ring->buffer_ring->bufs[ring->buffer_tail & (IO_URING_BUFFER_COUNT - 1)];
+
+  buffer->addr = (uint64_t)(uintptr_t)(ring->buffers + (size_t)buffer_id * IO_URING_BUFFER_SIZE);
+  buffer->len = IO_URING_BUFFER_SIZE;
+  buffer->bid = buffer_id;
+
+  ring->buffer_tail++;
+  __atomic_store_n(&ring->buffer_ring->tail, ring->buffer_tail, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Set up the ring and register the provided receive buffers
+ *
+ * Exits with error if io_uring is not available or the ring could not be mapped.
+ *
+ * @param ring The ring to set up
+ */
+static void setup_uring(uring *ring) {
+  struct io_uring_params params;
+  memset(&params, 0, sizeof(params));
+  memset(ring, 0, sizeof(uring));
+
+  // multishot operations produce more completions than submissions
+  params.flags = IORING_SETUP_CQSIZE | IORING_SETUP_CLAMP;
+  params.cq_entries = IO_URING_ENTRIES * 4;
+
+  ring->fd = (int)syscall(__NR_io_uring_setup, IO_URING_ENTRIES, &params);
+
+  if (ring->fd < 0) {
+    exit_err("setup_uring", "on io_uring_setup");
+  }
+
+  if (!(params.features & IORING_FEAT_SINGLE_MMAP)) {
+    exit_err("setup_uring", "kernel does not support IORING_FEAT_SINGLE_MMAP");
+  }
+
+  size_t sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  size_t cq_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+
+  // submission and completion queue share one mapping
+  ring->ring_size = sq_size > cq_size ? sq_size : cq_size;
+  ring->ring_ptr = mmap(NULL, ring->ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                        ring->fd, IORING_OFF_SQ_RING);
+
+  if (ring->ring_ptr == MAP_FAILED) {
+    exit_err("setup_uring", "on mmap of the rings");
+  }
+
+  ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+  ring->sqes = mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                    ring->fd, IORING_OFF_SQES);
+
+  if (ring->sqes == MAP_FAILED) {
+    exit_err("setup_uring", "on mmap of the submission queue entries");
+  }
+
+  char *ring_ptr = ring->ring_ptr;
+  ring->sq_head = (unsigned *)(ring_ptr + params.sq_off.head);
+  ring->sq_tail = (unsigned *)(ring_ptr + params.sq_off.tail);
+  ring->sq_array = (unsigned *)(ring_ptr + params.sq_off.array);
+  ring->sq_mask = *(unsigned *)(ring_ptr + params.sq_off.ring_mask);
+  ring->sq_entries = params.sq_entries;
+  ring->sq_local_tail = *ring->sq_tail;
+  ring->cq_head = (unsigned *)(ring_ptr + params.cq_off.head);
+  ring->cq_tail = (unsigned *)(ring_ptr + params.cq_off.tail);
+  ring->cq_mask = *(unsigned *)(ring_ptr + params.cq_off.ring_mask);
+  ring->cqes = (struct io_uring_cqe *)(ring_ptr + params.cq_off.cqes);
+
+  // the buffer ring has to be page aligned
+  ring->buffer_ring_size = IO_URING_BUFFER_COUNT * sizeof(struct io_uring_buf);
+  ring->buffer_ring = mmap(NULL, ring->buffer_ring_size, PROT_READ | PROT_WRITE,
+                           MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+  if (ring->buffer_ring == MAP_FAILED) {
+    exit_err("setup_uring", "on mmap of the buffer ring");
+  }
+
+  struct io_uring_buf_reg registration;
+  memset(&registration, 0, sizeof(registration));
+  registration.ring_addr = (uint64_t)(uintptr_t)ring->buffer_ring;
+  registration.ring_entries = IO_URING_BUFFER_COUNT;
+  registration.bgid = IO_URING_BUFFER_GROUP;
+
+  if (syscall(__NR_io_uring_register, ring->fd, IORING_REGISTER_PBUF_RING, &registration, 1) < 0) {
+    exit_err("setup_uring", "on io_uring_register of the buffer ring");
+  }
+
+  ring->buffers = malloc((size_t)IO_URING_BUFFER_COUNT * IO_URING_BUFFER_SIZE);
+
+  if (ring->buffers == NULL) {
+    exit_err("setup_uring", "at malloc.");
+  }
+
+  for (unsigned short i = 0; i < IO_URING_BUFFER_COUNT; i++) {
+    provide_buffer(ring, i);
+  }
+}
+
+/**
+ * @brief Unmap the ring and free the receive buffers
+ *
+ * Closing the ring cancels all operations that are still in flight.
+ *
+ * @param ring The ring to free
+ */
+static void free_uring(uring *ring) {
+  munmap(ring->sqes, ring->sqes_size);
+  munmap(ring->ring_ptr, ring->ring_size);
+  close(ring->fd);
+
+  munmap(ring->buffer_ring, ring->buffer_ring_size);
+  free(ring->buffers);
+}
+
+/**
+ * @brief Submit all prepared operations and wait for completions
+ *
+ * @param ring The ring
+ * @param wait_nr The number of completions to wait for
+ * @return The number of submitted operations, -1 on error (errno is set)
+ */
+static int submit(uring *ring, unsigned wait_nr) {
+  __atomic_store_n(ring->sq_tail, ring->sq_local_tail, __ATOMIC_RELEASE);
+
+  int submitted = (int)syscall(__NR_io_uring_enter, ring->fd, ring->to_submit, wait_nr,
+                               wait_nr > 0 ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+
+  if (submitted > 0) {
+    ring->to_submit -= submitted;
+  }
+
+  return submitted;
+}
+
+/**
+ * @brief Get a free submission queue entry
+ *
+ * Submits the prepared operations first if the submission queue is full.
+ * Exits with error if no entry could be freed.
+ *
+ * @param ring The ring
+ * @param user_data The user data of the operation
+ * @return The cleared entry
+ */
+static struct io_uring_sqe *get_sqe(uring *ring, uint64_t user_data) {
+  if (ring->sq_local_tail - __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE) >= ring->sq_entries) {
+    submit(ring, 0);
+
+    if (ring->sq_local_tail - __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE) >=
+        ring->sq_entries) {
+      exit_err("get_sqe", "submission queue is full");
+    }
+  }
+
+  unsigned index = ring->sq_local_tail & ring->sq_mask;
+  struct io_uring_sqe *sqe = &ring->sqes[index];
+
+  memset(sqe, 0, sizeof(struct io_uring_sqe));
+  sqe->user_data = user_data;
+
+  ring->sq_array[index] = index;
+  ring->sq_local_tail++;
+  ring->to_submit++;
+
+  return sqe;
+}
+
+/**
+ * @brief Build the user data of a connection operation
+ *
+ * @param connection The connection (allocated, so the lower bits are free)
+ * @param operation The operation
+ * @return The user data
+ */
+static uint64_t connection_data(connection_t *connection, uring_operation operation) {
+  return (uint64_t)(uintptr_t)connection | operation;
+}
+
+/**
+ * @brief Submit a multishot accept on the listening socket
+ *
+ * @param server The server
+ */
+static void prepare_accept(uring_server *server) {
+  struct io_uring_sqe *sqe = get_sqe(&server->ring, URING_ACCEPT);
+
+  sqe->opcode = IORING_OP_ACCEPT;
+  sqe->fd = server->sock_fd;
+  sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+  sqe->accept_flags = SOCK_CLOEXEC;
+
+  server->accept_armed = true;
+}
+
+/**
+ * @brief Submit a multishot recv into the provided buffers of a connection
+ *
+ * @param server The server
+ * @param connection The connection
+ */
+static void prepare_recv(uring_server *server, connection_t *connection) {
+  struct io_uring_sqe *sqe = get_sqe(&server->ring, connection_data(connection, URING_RECV));
+
+  sqe->opcode = IORING_OP_RECV;
+  sqe->fd = connection->fd;
+  sqe->ioprio = IORING_RECV_MULTISHOT;
+  sqe->flags = IOSQE_BUFFER_SELECT;
+  sqe->buf_group = IO_URING_BUFFER_GROUP;
+
+  connection->recv_armed = true;
+  connection->inflight++;
+}
+
+/**
+ * @brief Submit a splice of a part of a file body into the pipe of a connection
+ *
+ * The pipe is created on first use. Returns false if the pipe could not be created.
+ *
+ * @param server The server
+ * @param connection The connection
+ * @param file_fd The file
+ * @param offset The offset of the part in the file
+ * @param length The number of bytes left in the file body
+ * @return true if the splice has been submitted
+ */
+static bool prepare_splice(uring_server *server, connection_t *connection, int file_fd, off_t offset,
+                           size_t length) {
+  if (connection->pipe_fds[1] < 0 && pipe2(connection->pipe_fds, O_CLOEXEC) < 0) {
+    return false;
+  }
+
+  struct io_uring_sqe *sqe = get_sqe(&server->ring, connection_data(connection, URING_SPLICE));
+
+  sqe->opcode = IORING_OP_SPLICE;
+  sqe->splice_fd_in = file_fd;
+  sqe->splice_off_in = offset;
+  sqe->fd = connection->pipe_fds[1];
+  sqe->off = (uint64_t)-1;
+  sqe->len = length < IO_URING_SPLICE_SIZE ? length : IO_URING_SPLICE_SIZE;
+  sqe->splice_flags = SPLICE_F_MOVE;
+
+  connection->inflight++;
+
+  return true;
+}
+
+/**
+ * @brief Submit a send of the queued responses of a connection
+ *
+ * Heads and bodies are sent with a scatter-gather send. A file body is spliced into the pipe of the
+ * connection first and sent from the pipe once that completed. Returns false if the send could not
+ * be submitted.
+ *
+ * @param server The server
+ * @param connection The connection
+ * @return true if the send has been submitted
+ */
+static bool prepare_send(uring_server *server, connection_t *connection) {
+  off_t offset = 0;
+  size_t length = 0;
+  int file_fd = connection->pipe_pending > 0
+                    ? -1
+                    : connection_output_file(connection, &offset, &length);
+
+  if (file_fd >= 0) {
+    return prepare_splice(server, connection, file_fd, offset, length);
+  }
+
+  struct io_uring_sqe *sqe = get_sqe(&server->ring, connection_data(connection, URING_SEND));
+
+  connection->inflight++;
+
+  // the spliced part of a file body is sent from the pipe
+  if (connection->pipe_pending > 0) {
+    sqe->opcode = IORING_OP_SPLICE;
+    sqe->splice_fd_in = connection->pipe_fds[0];
+    sqe->splice_off_in = (uint64_t)-1;
+    sqe->fd = connection->fd;
+    sqe->off = (uint64_t)-1;
+    sqe->len = connection->pipe_pending;
+    sqe->splice_flags = SPLICE_F_MOVE;
+    return true;
+  }
+
+  // the message is stored in the connection and stays valid until the send completed
+  sqe->opcode = IORING_OP_SENDMSG;
+  sqe->fd = connection->fd;
+  sqe->addr = (uint64_t)(uintptr_t)connection_output(connection);
+  sqe->len = 1;
+  // a client that went away must not kill the server with SIGPIPE
+  sqe->msg_flags = MSG_NOSIGNAL;
+
+  return true;
+}
+
+/**
+ * @brief Submit the timeout that wakes up the loop to close idle connections
+ *
+ * @param server The server
+ */
+static void prepare_timeout(uring_server *server) {
+  struct io_uring_sqe *sqe = get_sqe(&server->ring, URING_TIMEOUT);
+
+  sqe->opcode = IORING_OP_TIMEOUT;
+  sqe->addr = (uint64_t)(uintptr_t)&server->timeout;
+  sqe->len = 1;
+}
+
+/**
+ * @brief Submit a poll on the wake file descriptor
+ *
+ * @param server The server
+ */
+static void prepare_wake(uring_server *server) {
+  struct io_uring_sqe *sqe = get_sqe(&server->ring, URING_WAKE);
+
+  sqe->opcode = IORING_OP_POLL_ADD;
+  sqe->fd = server->wake_fd;
+  sqe->poll32_events = POLLIN;
+}
+
+/**
+ * @brief Free a closed connection once none of its operations is in flight anymore
+ *
+ * @param server The server
+ * @param connection The connection
+ */
+static void release_connection(uring_server *server, connection_t *connection) {
+  if (connection->state != CONNECTION_CLOSED || connection->inflight > 0) {
+    return;
+  }
+
+  unlink_connection(&server->closing, connection);
+  free_connection(&connection);
+
+  // the accept may have stopped because no file descriptor was left
+  if (!server->accept_armed) {
+    prepare_accept(server);
+  }
+}
+
+/**
+ * @brief Close a connection
+ *
+ * All operations on the socket are cancelled (a send to a client that does not read would never
+ * complete on its own). The connection is freed once all of its operations completed.
+ *
+ * @param server The server
+ * @param connection The connection
+ */
+static void close_connection(uring_server *server, connection_t *connection) {
+  if (connection->state == CONNECTION_CLOSED) {
+    return;
+  }
+
+  unlink_connection(&server->connections, connection);
+  link_connection(&server->closing, connection);
+  connection->state = CONNECTION_CLOSED;
+
+  // the splice of a file into the pipe is not matched by the socket, it completes on its own
+  if (connection->inflight > 0) {
+    struct io_uring_sqe *sqe = get_sqe(&server->ring, URING_CANCEL);
+
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->fd = connection->fd;
+    sqe->cancel_flags = IORING_ASYNC_CANCEL_FD | IORING_ASYNC_CANCEL_ALL;
+  }
+
+  release_connection(server, connection);
+}
+
+/**
+ * @brief Process the received requests of a connection and send the responses
+ *
+ * Nothing is received while the responses are sent: the multishot recv is cancelled and armed again
+ * once the connection is reading (like the epoll loop stops reading while a write would block).
+ *
+ * @param server The server
+ * @param connection The connection
+ */
+static void process_requests(uring_server *server, connection_t *connection) {
+  if (process_connection(connection, server->handler) > 0) {
+    connection->state = CONNECTION_WRITING;
+
+    if (!prepare_send(server, connection)) {
+      close_connection(server, connection);
+      return;
+    }
+
+    if (connection->recv_armed) {
+      struct io_uring_sqe *sqe = get_sqe(&server->ring, URING_CANCEL);
+
+      sqe->opcode = IORING_OP_ASYNC_CANCEL;
+      sqe->addr = connection_data(connection, URING_RECV);
+    }
+
+    return;
+  }
+
+  // nothing left to answer
+  if (connection->peer_closed) {
+    close_connection(server, connection);
+  } else if (!connection->recv_armed && !server->recv_starved) {
+    prepare_recv(server, connection);
+  }
+}
+
+/**
+ * @brief Arm the recv of all reading connections that stopped because no buffer was left
+ *
+ * @param server The server
+ */
+static void resume_starved_recvs(uring_server *server) {
+  server->recv_starved = false;
+
+  for (connection_t *connection = server->connections.head; connection != NULL;
+       connection = connection->next) {
+    if (connection->state == CONNECTION_READING && !connection->recv_armed &&
+        !connection->peer_closed) {
+      prepare_recv(server, connection);
+    }
+  }
+}
+
+/**
+ * @brief Handle the completion of the multishot accept
+ *
+ * @param server The server
+ * @param result The accepted socket or a negative error
+ * @param flags The completion flags
+ */
+static void on_accept(uring_server *server, int result, unsigned flags) {
+  // the kernel stopped the multishot accept, after an error (e.g. EMFILE) it would fail again at
+  // once, it is armed again by the next timeout or once a connection has been released
+  if (!(flags & IORING_CQE_F_MORE)) {
+    server->accept_armed = false;
+
+    if (result >= 0) {
+      prepare_accept(server);
+    }
+  }
+
+  if (result < 0) {
+    return;
+  }
+
+  connection_t *connection = new_connection(result, server->pool);
+
+  if (connection == NULL) {
+    close(result);
+    return;
+  }
+
+  connection->last_active = server->now;
+  link_connection(&server->connections, connection);
+  prepare_recv(server, connection);
+}
+
+/**
+ * @brief Handle a completion of the multishot recv of a connection
+ *
+ * @param server The server
+ * @param connection The connection
+ * @param result The number of received bytes or a negative error
+ * @param flags The completion flags (contain the id of the used buffer)
+ */
+static void on_recv(uring_server *server, connection_t *connection, int result, unsigned flags) {
+  if (!(flags & IORING_CQE_F_MORE)) {
+    connection->recv_armed = false;
+    connection->inflight--;
+  }
+
+  if (flags & IORING_CQE_F_BUFFER) {
+    unsigned short buffer_id = flags >> IORING_CQE_BUFFER_SHIFT;
+
+    const char *data = server->ring.buffers + (size_t)buffer_id * IO_URING_BUFFER_SIZE;
+
+    if (result > 0 && connection->state != CONNECTION_CLOSED &&
+        !buffer_append(server->pool, &connection->in, data, result)) {
+      result = -ENOMEM;
+    }
+
+    provide_buffer(&server->ring, buffer_id);
+  }
+
+  if (connection->state == CONNECTION_CLOSED) {
+    release_connection(server, connection);
+    return;
+  }
+
+  // all provided buffers are in use, arming the recv again would fail at once
+  if (result == -ENOBUFS) {
+    server->recv_starved = true;
+  }
+
+  if (result == 0) {
+    connection->peer_closed = true;
+  } else if (result < 0 && result != -ENOBUFS && result != -ECANCELED) {
+    close_connection(server, connection);
+    return;
+  }
+
+  // only completions that were under way when the recv was cancelled arrive while writing
+  if (connection->state == CONNECTION_WRITING && connection->in != NULL &&
+      connection->in->length > IO_URING_MAX_BACKLOG) {
+    close_connection(server, connection);
+    return;
+  }
+
+  if (result >= 0) {
+    touch_connection(&server->connections, connection, server->now);
+  }
+
+  // a writing connection arms the recv again once its responses have been sent
+  if (connection->state == CONNECTION_READING) {
+    process_requests(server, connection);
+  }
+}
+
+/**
+ * @brief Handle the completion of a send of a connection
+ *
+ * @param server The server
+ * @param connection The connection
+ * @param result The number of sent bytes or a negative error
+ */
+static void on_send(uring_server *server, connection_t *connection, int result) {
+  connection->inflight--;
+
+  if (connection->state == CONNECTION_CLOSED) {
+    release_connection(server, connection);
+    return;
+  }
+
+  if (result < 0) {
+    close_connection(server, connection);
+    return;
+  }
+
+  // the send was a splice from the pipe
+  if (connection->pipe_pending > 0) {
+    connection->pipe_pending -= result;
+  }
+
+  touch_connection(&server->connections, connection, server->now);
+  connection->state = connection_sent(connection, result);
+
+  switch (connection->state) {
+  case CONNECTION_WRITING:
+    if (!prepare_send(server, connection)) {
+      close_connection(server, connection);
+    }
+    break;
+  case CONNECTION_READING:
+    // requests that have been received while sending, otherwise the recv is armed again
+    process_requests(server, connection);
+    break;
+  default:
+    connection->state = CONNECTION_READING;
+    close_connection(server, connection);
+  }
+}
+
+/**
+ * @brief Handle the completion of a splice of a file body into the pipe of a connection
+ *
+ * @param server The server
+ * @param connection The connection
+ * @param result The number of spliced bytes or a negative error
+ */
+static void on_splice(uring_server *server, connection_t *connection, int result) {
+  connection->inflight--;
+
+  if (connection->state == CONNECTION_CLOSED) {
+    release_connection(server, connection);
+    return;
+  }
+
+  // the file has been truncated, the announced content length can not be sent anymore
+  if (result <= 0) {
+    close_connection(server, connection);
+    return;
+  }
+
+  connection->pipe_pending = result;
+
+  if (!prepare_send(server, connection)) {
+    close_connection(server, connection);
+  }
+}
+
+/**
+ * @brief Handle a completion
+ *
+ * @param server The server
+ * @param cqe The completion queue entry
+ */
+static void handle_completion(uring_server *server, struct io_uring_cqe *cqe) {
+  uring_operation operation = cqe->user_data & URING_OPERATION_MASK;
+  connection_t *connection = (connection_t *)(uintptr_t)(cqe->user_data & ~URING_OPERATION_MASK);
+
+  switch (operation) {
+  case URING_ACCEPT:
+    on_accept(server, cqe->res, cqe->flags);
+    break;
+  case URING_RECV:
+    on_recv(server, connection, cqe->res, cqe->flags);
+    break;
+  case URING_SEND:
+    on_send(server, connection, cqe->res);
+    break;
+  case URING_SPLICE:
+    on_splice(server, connection, cqe->res);
+    break;
+  case URING_TIMEOUT:
+    prepare_timeout(server);
+
+    if (!server->accept_armed) {
+      prepare_accept(server);
+    }
+    break;
+  default:
+    // URING_WAKE: the loop checks run, URING_CANCEL: the cancelled operations complete on their own
+    break;
+  }
+}
+
+void io_uring_loop(int sock_fd, int wake_fd, request_handler handler, atomic_bool *run) {
+  uring_server server;
+  setup_uring(&server.ring);
+
+  server.sock_fd = sock_fd;
+  server.wake_fd = wake_fd;
+  server.handler = handler;
+  server.pool = new_buffer_pool();
+
+  if (server.pool == NULL) {
+    exit_err("io_uring_loop", "at calloc.");
+  }
+  server.now = monotonic_seconds();
+  server.connections = (connection_list){.head = NULL, .tail = NULL};
+  server.closing = (connection_list){.head = NULL, .tail = NULL};
+  server.recv_starved = false;
+  server.timeout.tv_sec = IO_URING_TIMEOUT_MS / 1000;
+  server.timeout.tv_nsec = (IO_URING_TIMEOUT_MS % 1000) * 1000000L;
+
+  prepare_accept(&server);
+  prepare_timeout(&server);
+
+  if (wake_fd >= 0) {
+    prepare_wake(&server);
+  }
+
+  uring *ring = &server.ring;
+
+  while (*run) {
+    if (submit(ring, 1) < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+      exit_err("io_uring_loop", "on io_uring_enter");
+    }
+
+    server.now = monotonic_seconds();
+
+    unsigned head = *ring->cq_head;
+    unsigned tail = __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+
+    while (head != tail) {
+      // copy the entry, handling it may submit and complete new operations
+      struct io_uring_cqe cqe = ring->cqes[head & ring->cq_mask];
+      __atomic_store_n(ring->cq_head, ++head, __ATOMIC_RELEASE);
+
+      handle_completion(&server, &cqe);
+    }
+
+    // the handled completions returned their buffers
+    if (server.recv_starved) {
+      resume_starved_recvs(&server);
+    }
+
+    connection_t *connection;
+
+    while ((connection = idle_connection(&server.connections, server.now)) != NULL) {
+      close_connection(&server, connection);
+    }
+  }
+
+  // closing the ring cancels all operations, afterwards the connections can be freed
+  free_uring(ring);
+
+  while (server.connections.head != NULL) {
+    connection_t *connection = server.connections.head;
+    unlink_connection(&server.connections, connection);
+    free_connection(&connection);
+  }
+
+  while (server.closing.head != NULL) {
+    connection_t *connection = server.closing.head;
+    unlink_connection(&server.closing, connection);
+    free_connection(&connection);
+  }
+
+  free_buffer_pool(&server.pool);
+}
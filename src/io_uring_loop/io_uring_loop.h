@@ -0,0 +1,60 @@
+#ifndef IO_URING_LOOP_H
+#define IO_URING_LOOP_H
+
+#include "../http_connection/http_connection.h"
+#include <stdatomic.h>
+#include <stdbool.h>
+
+/**
+ * Number of submission queue entries of the ring.
+ */
+#define IO_URING_ENTRIES 1024
+
+/**
+ * Number of provided receive buffers (must be a power of 2).
+ */
+#define IO_URING_BUFFER_COUNT 256
+
+/**
+ * Size of a provided receive buffer.
+ */
+#define IO_URING_BUFFER_SIZE 16384
+
+/**
+ * Maximum number of bytes a connection may have received while its responses are sent. The recv of
+ * a writing connection is cancelled, only completions that were already under way are buffered.
+ */
+#define IO_URING_MAX_BACKLOG (HTTP_MAX_REQUEST_SIZE + IO_URING_BUFFER_SIZE)
+
+/**
+ * Buffer group id of the provided receive buffers.
+ */
+#define IO_URING_BUFFER_GROUP 0
+
+/**
+ * Maximum number of bytes of a file body spliced into the pipe of a connection at once (the default
+ * capacity of a pipe).
+ */
+#define IO_URING_SPLICE_SIZE 65536
+
+/**
+ * @brief Run the io_uring event loop for a listening socket
+ *
+ * Alternative to event_loop() that replaces the read/write syscalls with io_uring operations:
+ * connections are accepted with one multishot accept, every connection receives with a multishot
+ * recv into the registered provided buffer ring and responses are sent with sendmsg operations (file
+ * bodies are spliced from the file through a pipe into the socket without copying them). The
+ * requests are processed by the same connection pipeline (process_connection()) as in event_loop().
+ * The loop runs until run is set to false, remaining connections are closed afterwards.
+ *
+ * Exits with error if the ring could not be set up (e.g. io_uring is not supported by the kernel).
+ *
+ * @param sock_fd The listening socket
+ * @param wake_fd File descriptor that becomes readable once the loop should check run (e.g. an
+ * eventfd), -1 to only rely on EINTR
+ * @param handler The handler that turns a raw request into an encoded response
+ * @param run Flag that stops the loop once it is false
+ */
+void io_uring_loop(int sock_fd, int wake_fd, request_handler handler, atomic_bool *run);
+
+#endif
@@ -0,0 +1,185 @@
+#define _GNU_SOURCE
+
+#include "../../../lib/arena/arena.h"
+#include "../../../main.h"
+#include "../../../src/http_router/http_router.h"
+#include "../../../src/http_server/http_server.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/**
+ * Requests that are handled by the benchmark: a cached file, the debug page, a missing file (error
+ * response) and an invalid request.
+ */
+static const char *benchmark_requests[][2] = {
+    {"file", "GET /index.html HTTP/1.1\r\nHost: localhost:31337\r\nUser-Agent: curl/8.5.0\r\n"
+             "Accept: */*\r\n\r\n"},
+    {"debug", "GET /debug HTTP/1.1\r\nHost: localhost\r\n\r\n"},
+    {"404", "GET /missing.html HTTP/1.1\r\nHost: localhost\r\n\r\n"},
+    {"400", "GET\r\n\r\n"}};
+
+/**
+ * Allocator calls of the benchmark (malloc, calloc and realloc) and calls of free.
+ */
+static size_t allocation_count = 0;
+static size_t free_count = 0;
+
+// the allocator is wrapped by the linker (-Wl,--wrap=...), so every call of the server is counted
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t count, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+void __real_free(void *ptr);
+
+void *__wrap_malloc(size_t size) {
+  allocation_count++;
+  return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t count, size_t size) {
+  allocation_count++;
+  return __real_calloc(count, size);
+}
+
+void *__wrap_realloc(void *ptr, size_t size) {
+  allocation_count++;
+  return __real_realloc(ptr, size);
+}
+
+void __wrap_free(void *ptr) {
+  if (ptr != NULL) {
+    free_count++;
+  }
+
+  __real_free(ptr);
+}
+
+/**
+ * @brief Get the current monotonic time in seconds
+ *
+ * @return the current time
+ */
+static double now() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+/**
+ * @brief Handle a request like a connection does (in place, with the arena of the connection)
+ *
+ * @param raw_request the raw request
+ * @param arena the arena that is released after the response
+ * @return true if a response has been created
+ */
+static bool handle_request(const char *raw_request, arena *arena) {
+  char data[HTTP_MAX_REQUEST_SIZE + 1];
+  size_t length = strlen(raw_request);
+
+  // the request is modified in place by the server
+  memcpy(data, raw_request, length + 1);
+  string request = {.len = length, .str = data};
+
+  bool keep_alive = true;
+  encoded_response_t *response = http_server(&request, &keep_alive, arena);
+  bool handled = response != NULL;
+
+  free_encoded_response(&response);
+  release_arena(arena);
+
+  return handled;
+}
+
+/**
+ * @brief Handle a request repeatedly and print the allocator calls and the time per request
+ *
+ * @param name the name of the request
+ * @param raw_request the raw request
+ * @param arena the arena of the connection
+ * @param iterations the number of runs
+ * @return true if every run created a response
+ */
+static bool run_request(const char *name, const char *raw_request, arena *arena, long iterations) {
+  // the first run fills the file cache and the buffer pool
+  bool handled = handle_request(raw_request, arena);
+
+  size_t allocations = allocation_count;
+  size_t frees = free_count;
+  double start = now();
+
+  for (long i = 0; i < iterations; i++) {
+    handled &= handle_request(raw_request, arena);
+  }
+
+  double elapsed = now() - start;
+
+  printf("  %-6s %6.2f allocations/request, %6.2f frees/request, %8.1f ns/request\n", name,
+         (double)(allocation_count - allocations) / (double)iterations,
+         (double)(free_count - frees) / (double)iterations, elapsed * 1e9 / (double)iterations);
+
+  return handled;
+}
+
+/**
+ * @brief Benchmark of the allocations per request
+ *
+ * Handles every benchmark request the given number of times with http_server() and prints the
+ * number of allocator calls (malloc, calloc, realloc) and frees per request and the time per
+ * request. Has to be run from the repository root (the files are served from DOCUMENT_ROOT).
+ *
+ * Usage: alloc_benchmark.out [-n iterations]
+ *
+ * @param argc the number of arguments
+ * @param argv the arguments
+ * @return the exit status
+ */
+int main(int argc, char *argv[]) {
+  long iterations = 100000;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "n:")) != -1) {
+    switch (opt) {
+    case 'n':
+      iterations = atol(optarg);
+      break;
+    default:
+      fprintf(stderr, "usage: %s [-n iterations]\n", argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+
+  if (iterations <= 0) {
+    fprintf(stderr, "iterations have to be positive\n");
+    return EXIT_FAILURE;
+  }
+
+  buffer_pool *pool = new_buffer_pool();
+
+  if (pool == NULL) {
+    fprintf(stderr, "the buffer pool could not be created\n");
+    return EXIT_FAILURE;
+  }
+
+  arena arena;
+  init_arena(&arena, pool);
+  open_document_roots();
+  bool handled = true;
+
+  for (size_t i = 0; i < sizeof(benchmark_requests) / sizeof(benchmark_requests[0]); i++) {
+    handled &= run_request(benchmark_requests[i][0], benchmark_requests[i][1], &arena, iterations);
+  }
+
+  free_router_file_cache();
+  close_document_roots();
+  free_buffer_pool(&pool);
+
+  if (!handled) {
+    fprintf(stderr, "a request could not be handled\n");
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,329 @@
+#define _GNU_SOURCE
+
+#include <arpa/inet.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <time.h>
+#include <unistd.h>
+
+#define LOAD_RESPONSE_BUFFER_SIZE 65536
+
+struct load_options {
+  const char *host;
+  int port;
+  int connections;
+  int duration;
+  bool keep_alive;
+  const char *path;
+} typedef load_options;
+
+struct load_worker {
+  pthread_t thread;
+  const load_options *options;
+  double deadline;
+  size_t requests;
+  size_t errors;
+  double *latencies;
+  size_t latencies_cap;
+} typedef load_worker;
+
+/**
+ * @brief Get the current monotonic time in seconds
+ *
+ * @return the current time
+ */
+static double now() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+/**
+ * @brief Connect to the server
+ *
+ * @param options the benchmark options
+ * @return the socket file descriptor, -1 on error
+ */
+static int connect_server(const load_options *options) {
+  struct sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(options->port);
+  inet_pton(AF_INET, options->host, &addr.sin_addr);
+
+  int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+
+  if (fd < 0) {
+    return -1;
+  }
+
+  if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+    close(fd);
+    return -1;
+  }
+
+  return fd;
+}
+
+/**
+ * @brief Read one complete response (head and Content-Length bytes of body)
+ *
+ * @param fd the socket
+ * @param buffer buffer of LOAD_RESPONSE_BUFFER_SIZE bytes
+ * @param server_closes set to true if the server will close the connection after the response
+ * @return 0 on success, -1 on error
+ */
+static int read_response(int fd, char *buffer, bool *server_closes) {
+  size_t received = 0;
+  size_t expected = 0;
+  char *end_of_head = NULL;
+
+  while (end_of_head == NULL || received < expected) {
+    if (end_of_head == NULL && received == LOAD_RESPONSE_BUFFER_SIZE - 1) {
+      return -1;
+    }
+
+    // the body is not kept, only the head has to stay in the buffer
+    size_t offset = end_of_head == NULL ? received : 0;
+    size_t space = end_of_head == NULL ? LOAD_RESPONSE_BUFFER_SIZE - 1 - received
+                                       : LOAD_RESPONSE_BUFFER_SIZE;
+    ssize_t length = read(fd, buffer + offset, space);
+
+    if (length <= 0) {
+      return -1;
+    }
+
+    received += length;
+
+    if (end_of_head != NULL) {
+      continue;
+    }
+
+    buffer[received] = '\0';
+    end_of_head = strstr(buffer, "\r\n\r\n");
+
+    if (end_of_head == NULL) {
+      continue;
+    }
+
+    *end_of_head = '\0';
+
+    const char *content_length = strcasestr(buffer, "\r\ncontent-length:");
+    const char *connection = strcasestr(buffer, "\r\nconnection:");
+
+    size_t body_len = content_length == NULL ? 0 : strtoul(content_length + 17, NULL, 10);
+    expected = (size_t)(end_of_head - buffer) + 4 + body_len;
+
+    *server_closes = connection == NULL || strncasecmp(connection + 13, " close", 6) == 0;
+  }
+
+  return 0;
+}
+
+/**
+ * @brief Record the latency of a request
+ *
+ * @param worker the worker that sent the request
+ * @param latency the latency in seconds
+ */
+static void record_latency(load_worker *worker, double latency) {
+  if (worker->requests == worker->latencies_cap) {
+    worker->latencies_cap = worker->latencies_cap == 0 ? 4096 : worker->latencies_cap * 2;
+    worker->latencies = realloc(worker->latencies, worker->latencies_cap * sizeof(double));
+
+    if (worker->latencies == NULL) {
+      perror("realloc");
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  worker->latencies[worker->requests++] = latency;
+}
+
+/**
+ * @brief Worker thread that sends requests until the deadline
+ *
+ * @param arg the load_worker
+ * @return NULL
+ */
+static void *run_worker(void *arg) {
+  load_worker *worker = arg;
+  const load_options *options = worker->options;
+
+  char *buffer = malloc(LOAD_RESPONSE_BUFFER_SIZE);
+  char request[1024];
+
+  if (buffer == NULL) {
+    perror("malloc");
+    exit(EXIT_FAILURE);
+  }
+
+  int request_len = snprintf(request, sizeof(request), "GET %s HTTP/1.1\r\nHost: %s\r\n%s\r\n",
+                             options->path, options->host,
+                             options->keep_alive ? "" : "Connection: close\r\n");
+
+  int fd = -1;
+
+  while (now() < worker->deadline) {
+    if (fd < 0) {
+      fd = connect_server(options);
+
+      if (fd < 0) {
+        worker->errors++;
+        continue;
+      }
+    }
+
+    double start = now();
+    bool server_closes = true;
+
+    if (write(fd, request, request_len) != request_len ||
+        read_response(fd, buffer, &server_closes) < 0) {
+      worker->errors++;
+      close(fd);
+      fd = -1;
+      continue;
+    }
+
+    record_latency(worker, now() - start);
+
+    if (server_closes || !options->keep_alive) {
+      close(fd);
+      fd = -1;
+    }
+  }
+
+  if (fd >= 0) {
+    close(fd);
+  }
+
+  free(buffer);
+
+  return NULL;
+}
+
+/**
+ * @brief Compare two latencies for qsort()
+ */
+static int compare_latency(const void *a, const void *b) {
+  double diff = *(const double *)a - *(const double *)b;
+
+  return (diff > 0) - (diff < 0);
+}
+
+/**
+ * @brief HTTP load generator
+ *
+ * Opens `-c` concurrent connections to the server and sends GET requests for `-d` seconds.
+ * Prints the number of requests per second and the p50/p99 latency.
+ *
+ * Usage: load_benchmark.out [-h host] [-p port] [-c connections] [-d seconds] [-k] [path]
+ *
+ * @param argc the number of arguments
+ * @param argv the arguments
+ * @return the exit status
+ */
+int main(int argc, char *argv[]) {
+  load_options options = {.host = "127.0.0.1",
+                          .port = 31337,
+                          .connections = 64,
+                          .duration = 5,
+                          .keep_alive = false,
+                          .path = "/index.html"};
+  int opt;
+
+  while ((opt = getopt(argc, argv, "h:p:c:d:k")) != -1) {
+    switch (opt) {
+    case 'h':
+      options.host = optarg;
+      break;
+    case 'p':
+      options.port = atoi(optarg);
+      break;
+    case 'c':
+      options.connections = atoi(optarg);
+      break;
+    case 'd':
+      options.duration = atoi(optarg);
+      break;
+    case 'k':
+      options.keep_alive = true;
+      break;
+    default:
+      fprintf(stderr, "usage: %s [-h host] [-p port] [-c connections] [-d seconds] [-k] [path]\n",
+              argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+
+  if (optind < argc) {
+    options.path = argv[optind];
+  }
+
+  if (options.connections <= 0 || options.duration <= 0) {
+    fprintf(stderr, "connections and duration have to be positive\n");
+    return EXIT_FAILURE;
+  }
+
+  load_worker *workers = calloc(options.connections, sizeof(load_worker));
+
+  if (workers == NULL) {
+    perror("calloc");
+    return EXIT_FAILURE;
+  }
+
+  double start = now();
+
+  for (int i = 0; i < options.connections; i++) {
+    workers[i].options = &options;
+    workers[i].deadline = start + options.duration;
+    pthread_create(&workers[i].thread, NULL, run_worker, &workers[i]);
+  }
+
+  size_t requests = 0;
+  size_t errors = 0;
+
+  for (int i = 0; i < options.connections; i++) {
+    pthread_join(workers[i].thread, NULL);
+    requests += workers[i].requests;
+    errors += workers[i].errors;
+  }
+
+  double elapsed = now() - start;
+
+  // merge all latencies to compute the percentiles
+  double *latencies = malloc((requests + 1) * sizeof(double));
+  size_t count = 0;
+
+  if (latencies == NULL) {
+    perror("malloc");
+    return EXIT_FAILURE;
+  }
+
+  for (int i = 0; i < options.connections; i++) {
+    memcpy(latencies + count, workers[i].latencies, workers[i].requests * sizeof(double));
+    count += workers[i].requests;
+    free(workers[i].latencies);
+  }
+
+  qsort(latencies, count, sizeof(double), compare_latency);
+
+  double p50 = count == 0 ? 0 : latencies[count / 2];
+  double p99 = count == 0 ? 0 : latencies[(size_t)((double)(count - 1) * 0.99)];
+
+  printf("requests: %zu, errors: %zu, duration: %.2fs\n", requests, errors, elapsed);
+  printf("requests/sec: %.0f\n", (double)requests / elapsed);
+  printf("latency p50: %.3fms, p99: %.3fms\n", p50 * 1000, p99 * 1000);
+
+  free(latencies);
+  free(workers);
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,143 @@
+#define _GNU_SOURCE
+
+#include "../../../src/http_parser/http_parser.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/**
+ * Requests that are parsed by the benchmark: a minimal request, a typical curl request and a browser
+ * request with many headers.
+ */
+static const char *benchmark_requests[] = {
+    "GET / HTTP/1.1\r\nHost: localhost\r\n\r\n",
+    "GET /index.html HTTP/1.1\r\nHost: localhost:31337\r\nUser-Agent: curl/8.5.0\r\n"
+    "Accept: */*\r\n\r\n",
+    "GET /images/logo.png?size=large HTTP/1.1\r\nHost: extern.localhost:31337\r\n"
+    "User-Agent: Mozilla/5.0 (X11; Linux x86_64; rv:128.0) Gecko/20100101 Firefox/128.0\r\n"
+    "Accept: image/avif,image/webp,image/png,image/svg+xml,image/*;q=0.8,*/*;q=0.5\r\n"
+    "Accept-Language: en-US,en;q=0.5\r\nAccept-Encoding: gzip, deflate, br, zstd\r\n"
+    "Referer: http://extern.localhost:31337/index.html\r\nDNT: 1\r\nSec-GPC: 1\r\n"
+    "Connection: keep-alive\r\nSec-Fetch-Dest: image\r\nSec-Fetch-Mode: no-cors\r\n"
+    "Sec-Fetch-Site: same-origin\r\nPriority: u=5, i\r\nPragma: no-cache\r\n"
+    "Cache-Control: no-cache\r\n\r\n"};
+
+/**
+ * @brief Get the current monotonic time in seconds
+ *
+ * @return the current time
+ */
+static double now() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+/**
+ * @brief Parse a request into a view (in place, without allocations)
+ *
+ * @param raw_request the raw request
+ * @return true if the request has been parsed
+ */
+static bool parse_view(string *raw_request) {
+  request_view request;
+
+  return parse_request_view(raw_request, &request) == EXIT_SUCCESS &&
+         get_request_header(&request, REQUEST_HEADER_HOST).len > 0;
+}
+
+/**
+ * @brief Parse a request into a request object (copies every field)
+ *
+ * @param raw_request the raw request
+ * @return true if the request has been parsed
+ */
+static bool parse_object(string *raw_request) {
+  request_t *request = parse_request_string(raw_request);
+  bool parsed = request != NULL && get_length(request->host) > 0;
+
+  free_request(&request);
+
+  return parsed;
+}
+
+/**
+ * @brief Parse a request repeatedly and print the time per request
+ *
+ * @param name the name of the parser
+ * @param parse the parser
+ * @param raw_request the raw request
+ * @param iterations the number of runs
+ * @return true if every run parsed the request
+ */
+static bool run_parser(const char *name, bool (*parse)(string *), string *raw_request,
+                       long iterations) {
+  bool parsed = true;
+  double start = now();
+
+  for (long i = 0; i < iterations; i++) {
+    parsed &= parse(raw_request);
+  }
+
+  double elapsed = now() - start;
+
+  printf("  %-8s %8.1f ns/request, %8.1f MB/s\n", name, elapsed * 1e9 / (double)iterations,
+         (double)raw_request->len * (double)iterations / elapsed / 1e6);
+
+  return parsed;
+}
+
+/**
+ * @brief Microbenchmark of the request parser
+ *
+ * Parses every benchmark request the given number of times into a request view and into a request
+ * object and prints the time per request and the parsed bytes per second.
+ *
+ * Usage: parser_benchmark.out [-n iterations]
+ *
+ * @param argc the number of arguments
+ * @param argv the arguments
+ * @return the exit status
+ */
+int main(int argc, char *argv[]) {
+  long iterations = 1000000;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "n:")) != -1) {
+    switch (opt) {
+    case 'n':
+      iterations = atol(optarg);
+      break;
+    default:
+      fprintf(stderr, "usage: %s [-n iterations]\n", argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+
+  if (iterations <= 0) {
+    fprintf(stderr, "iterations have to be positive\n");
+    return EXIT_FAILURE;
+  }
+
+  bool parsed = true;
+
+  for (size_t i = 0; i < sizeof(benchmark_requests) / sizeof(benchmark_requests[0]); i++) {
+    string *raw_request = str_cpy(benchmark_requests[i], strlen(benchmark_requests[i]));
+
+    printf("request %zu (%zu bytes):\n", i + 1, raw_request->len);
+    parsed &= run_parser("view", parse_view, raw_request, iterations);
+    parsed &= run_parser("object", parse_object, raw_request, iterations);
+
+    free_str(raw_request);
+  }
+
+  if (!parsed) {
+    fprintf(stderr, "a request could not be parsed\n");
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,231 @@
+#define _GNU_SOURCE
+
+#include "../../../lib/string_lib/string_lib.h"
+#include <ctype.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/**
+ * Size of the adversarial haystacks (the maximum size of a request head).
+ */
+#define STRING_BENCHMARK_ADVERSARIAL_SIZE 8192
+
+/**
+ * Realistic request head of a browser.
+ */
+static const char *benchmark_head =
+    "GET /images/logo.png?size=large HTTP/1.1\r\nHost: extern.localhost:31337\r\n"
+    "User-Agent: Mozilla/5.0 (X11; Linux x86_64; rv:128.0) Gecko/20100101 Firefox/128.0\r\n"
+    "Accept: image/avif,image/webp,image/png,image/svg+xml,image/*;q=0.8,*/*;q=0.5\r\n"
+    "Accept-Language: en-US,en;q=0.5\r\nAccept-Encoding: gzip, deflate, br, zstd\r\n"
+    "Referer: http://extern.localhost:31337/index.html\r\nDNT: 1\r\nSec-GPC: 1\r\n"
+    "Connection: keep-alive\r\nSec-Fetch-Dest: image\r\nSec-Fetch-Mode: no-cors\r\n"
+    "Sec-Fetch-Site: same-origin\r\nPriority: u=5, i\r\nPragma: no-cache\r\n"
+    "Cache-Control: no-cache\r\n\r\n";
+
+/**
+ * A search of the benchmark.
+ */
+struct search_case {
+  const char *name;
+  str_view haystack;
+  str_view needle;
+  bool ignore_case;
+  // searches for the first control character instead of the needle
+  bool control;
+} typedef search_case;
+
+/**
+ * @brief Get the current monotonic time in seconds
+ *
+ * @return the current time
+ */
+static double now() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+/**
+ * @brief The byte by byte search str_str() used before the SIMD search functions (the reference)
+ *
+ * @param haystack the string to search in
+ * @param needle the string to search
+ * @param ignore_case whether the case is ignored (with tolower() per byte)
+ * @return the first occurrence, NULL if there is none
+ */
+static const char *naive_search(str_view haystack, str_view needle, bool ignore_case) {
+  if (needle.len > haystack.len) {
+    return NULL;
+  }
+
+  for (size_t i = 0; i <= haystack.len - needle.len; i++) {
+    for (size_t j = 0; j < needle.len; j++) {
+      char current = haystack.str[i + j];
+      char expected = needle.str[j];
+
+      if (ignore_case ? tolower(current) != tolower(expected) : current != expected) {
+        break;
+      }
+
+      if (j == needle.len - 1) {
+        return haystack.str + i;
+      }
+    }
+  }
+
+  return NULL;
+}
+
+/**
+ * @brief Run a search once
+ *
+ * @param search the search
+ * @param naive whether the reference implementation is used
+ * @return the result of the search
+ */
+static const char *run_search(const search_case *search, bool naive) {
+  if (search->control) {
+    return str_find_control(search->haystack);
+  }
+
+  if (naive) {
+    return naive_search(search->haystack, search->needle, search->ignore_case);
+  }
+
+  return search->ignore_case ? str_find_ignore_case(search->haystack, search->needle)
+                             : str_find(search->haystack, search->needle);
+}
+
+/**
+ * @brief Run a search repeatedly and print the time per search
+ *
+ * @param search the search
+ * @param name the name of the implementation
+ * @param naive whether the reference implementation is used
+ * @param iterations the number of runs
+ * @return the result of the search
+ */
+static const char *measure_search(const search_case *search, const char *name, bool naive,
+                                  long iterations) {
+  const char *volatile result = NULL;
+  double start = now();
+
+  for (long i = 0; i < iterations; i++) {
+    result = run_search(search, naive);
+  }
+
+  double elapsed = now() - start;
+
+  printf("  %-8s %10.1f ns/search, %8.2f GB/s\n", name, elapsed * 1e9 / (double)iterations,
+         (double)search->haystack.len * (double)iterations / elapsed / 1e9);
+
+  return result;
+}
+
+/**
+ * @brief Microbenchmark of the string search functions
+ *
+ * Compares the byte by byte str_str() that was used before with the scalar, SSE2 and AVX2 versions
+ * of the search functions on a realistic request head and on adversarial inputs (long partial
+ * matches at every position). The instruction sets that the CPU does not support are skipped.
+ *
+ * Usage: string_benchmark.out [-n iterations]
+ *
+ * @param argc the number of arguments
+ * @param argv the arguments
+ * @return the exit status
+ */
+int main(int argc, char *argv[]) {
+  static const char *level_names[] = {"scalar", "sse2", "avx2"};
+  long iterations = 100000;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "n:")) != -1) {
+    switch (opt) {
+    case 'n':
+      iterations = atol(optarg);
+      break;
+    default:
+      fprintf(stderr, "usage: %s [-n iterations]\n", argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+
+  if (iterations <= 0) {
+    fprintf(stderr, "iterations have to be positive\n");
+    return EXIT_FAILURE;
+  }
+
+  char *same = malloc(STRING_BENCHMARK_ADVERSARIAL_SIZE);
+  char *upper = malloc(STRING_BENCHMARK_ADVERSARIAL_SIZE);
+
+  if (same == NULL || upper == NULL) {
+    perror("malloc");
+    return EXIT_FAILURE;
+  }
+
+  memset(same, 'a', STRING_BENCHMARK_ADVERSARIAL_SIZE);
+  memset(upper, 'A', STRING_BENCHMARK_ADVERSARIAL_SIZE);
+
+  str_view head = {.str = benchmark_head, .len = strlen(benchmark_head)};
+  str_view user_agent = {.str = strstr(benchmark_head, "Mozilla"), .len = 80};
+  search_case searches[] = {
+      {.name = "end of head (\\r\\n\\r\\n)",
+       .haystack = head,
+       .needle = {.str = "\r\n\r\n", .len = 4}},
+      {.name = "header name (ignore case)",
+       .haystack = head,
+       .needle = {.str = "cache-control:", .len = 14},
+       .ignore_case = true},
+      {.name = "end of header value (control)", .haystack = user_agent, .control = true},
+      {.name = "adversarial",
+       .haystack = {.str = same, .len = STRING_BENCHMARK_ADVERSARIAL_SIZE},
+       .needle = {.str = "aaaaaaaaaaaaaaab", .len = 16}},
+      {.name = "adversarial (every position is a candidate)",
+       .haystack = {.str = same, .len = STRING_BENCHMARK_ADVERSARIAL_SIZE},
+       .needle = {.str = "aaaaaaaaaaaaaaba", .len = 16}},
+      {.name = "adversarial (ignore case)",
+       .haystack = {.str = upper, .len = STRING_BENCHMARK_ADVERSARIAL_SIZE},
+       .needle = {.str = "aaaaaaaaaaaaaaab", .len = 16},
+       .ignore_case = true}};
+
+  str_simd_level supported = get_str_simd_level();
+  bool equal = true;
+
+  for (size_t i = 0; i < sizeof(searches) / sizeof(searches[0]); i++) {
+    printf("%s (%zu bytes):\n", searches[i].name, searches[i].haystack.len);
+
+    // the control search has no byte by byte reference, the scalar version is the reference
+    const char *expected = searches[i].control
+                               ? NULL
+                               : measure_search(&searches[i], "naive", true, iterations);
+
+    for (str_simd_level level = STR_SIMD_SCALAR; level <= supported; level++) {
+      set_str_simd_level(level);
+      const char *result = measure_search(&searches[i], level_names[level], false, iterations);
+
+      if (level == STR_SIMD_SCALAR && searches[i].control) {
+        expected = result;
+      }
+
+      equal &= result == expected;
+    }
+  }
+
+  set_str_simd_level(supported);
+  free(same);
+  free(upper);
+
+  if (!equal) {
+    fprintf(stderr, "the search results differ\n");
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -5,10 +5,11 @@
 # responses with user-defined expected responses.
 from __future__ import unicode_literals
 
+import socket
 import sys
 
 from pewpewlaz0rt4nk import (
-    Beam,
+    Beam as PersistentBeam,
     Laz0rCannon,
 )
 
@@ -25,6 +26,18 @@ if len(sys.argv) == 3:
     _, host, port = sys.argv
     port = int(port)
 
+
+def Beam(**kwargs):
+    """
+    Beam that closes its sending side after the request.
+
+    HTTP/1.1 connections are persistent, the server only closes them once the client has closed its
+    side (or after the keep-alive timeout).
+    """
+    kwargs.setdefault("shutdown", socket.SHUT_WR)
+    return PersistentBeam(**kwargs)
+
+
 # Initialise Laz0rCannon
 cannon = Laz0rCannon(host=host, port=port)
 
@@ -281,6 +294,66 @@ cannon += Beam(
 )
 
 
+#
+# Connection
+#
+cannon += Beam(
+    description='HTTP/1.0 without keep-alive closes the connection',
+    request='GET /debug HTTP/1.0\r\nHost: {host}:{port}\r\n\r\n',
+    response=[
+        'HTTP/1.1 200 OK',
+        'Content-Type: text/html',
+        'Content-Length: 130',
+        'Server: ',
+        'Connection: close',
+    ],
+    shutdown=False,
+)
+cannon += Beam(
+    description='HTTP/1.1 with Connection: close closes the connection',
+    request='GET /debug HTTP/1.1\r\nHost: {host}:{port}\r\nConnection: close\r\n\r\n',
+    response=[
+        'HTTP/1.1 200 OK',
+        'Content-Type: text/html',
+        'Content-Length: 130',
+        'Server: ',
+        'Connection: close',
+    ],
+    shutdown=False,
+)
+cannon += Beam(
+    description='Invalid request closes the connection',
+    request='GET /debug HTTP/1.1 Test\r\nHost: {host}:{port}\r\n\r\n',
+    response=['HTTP/1.1 400 Bad Request'],
+    shutdown=False,
+)
+cannon += Beam(
+    description='Oversized request head is rejected before it is complete',
+    request='GET /debug HTTP/1.1\r\nHost: {host}:{port}\r\nX-Padding: ' + 'a' * 9000,
+    response=['HTTP/1.1 431 Request Header Fields Too Large', 'Content-Type: text/html'],
+    shutdown=False,
+)
+cannon += Beam(
+    description='Pipelined requests are answered in order',
+    request='GET /debug HTTP/1.1\r\nHost: {host}:{port}\r\n\r\n'
+            'GET /debug HTTP/1.1\r\nHost: {host}:{port}\r\nConnection: close\r\n\r\n',
+    response=[
+        'HTTP/1.1 200 OK',
+        'Content-Type: text/html',
+        'Content-Length: 130',
+        'Server: ',
+        'Connection: keep-alive',
+        '',
+        '<html><head><title>Debug</title></head>',
+        'Content-Type: text/html',
+        'Content-Length: 130',
+        'Server: ',
+        'Connection: close',
+    ],
+    shutdown=False,
+)
+
+
 # Pew pew!
 successful = cannon.pewpew()
 sys.exit(0 if successful else 1)
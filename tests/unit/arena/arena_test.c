@@ -0,0 +1,89 @@
+#include "arena_test.h"
+#include "../../../lib/arena/arena.h"
+#include "../../../lib/buffer_pool/buffer_pool.h"
+#include "../../../lib/string_lib/string_lib.h"
+#include "../../../lib/testing/unit/test-lib.h"
+#include <stdint.h>
+
+void test_arena_alloc() {
+  test_title("Test arena_alloc() and release_arena()");
+
+  buffer_pool *pool = new_buffer_pool();
+  arena arena;
+  init_arena(&arena, pool);
+  expect_null(arena.blocks);
+
+  char *first = arena_alloc(&arena, 3);
+  char *second = arena_alloc(&arena, 5);
+  expect_not_null(first);
+  expect_true((uintptr_t)second % ARENA_ALIGNMENT == 0);
+  expect_true(second == first + ARENA_ALIGNMENT);
+
+  // only the last allocation grows in place
+  expect_true(arena_extend(&arena, second, 100));
+  expect_false(arena_extend(&arena, first, 10));
+  expect_false(arena_extend(&arena, second, ARENA_BLOCK_SIZE + 1));
+
+  // a full block is replaced, large allocations get a block of their own
+  char *large = arena_alloc(&arena, ARENA_BLOCK_SIZE * 4);
+  expect_not_null(large);
+  expect_true(arena.blocks->capacity >= ARENA_BLOCK_SIZE * 4);
+  expect_not_null(arena.blocks->next);
+
+  // the blocks are returned to the pool and reused
+  buffer_t *block = arena.blocks->next;
+  release_arena(&arena);
+  expect_null(arena.blocks);
+  expect_true(arena_alloc(&arena, 8) == block->data);
+
+  release_arena(&arena);
+  free_buffer_pool(&pool);
+}
+
+void test_str_arena() {
+  test_title("Test string functions in an arena");
+
+  buffer_pool *pool = new_buffer_pool();
+  arena arena;
+  init_arena(&arena, pool);
+
+  string *str = new_string_arena(&arena);
+  expect_equal(str, 0, "");
+
+  // the last allocation grows without being moved
+  char *start = str->str;
+  str_cat_arena(&arena, str, "HTTP/1.1 ", 9);
+  str_cat_arena(&arena, str, "200 OK", 6);
+  expect_equal(str, 15, "HTTP/1.1 200 OK");
+  expect_true(str->str == start);
+
+  // an earlier string is moved behind the newer allocations
+  string *number = size_t_to_string_arena(&arena, 4096);
+  expect_equal(number, 4, "4096");
+  str_cat_arena(&arena, str, "\r\nServer: http-c-erver", 22);
+  expect_equal(str, 37, "HTTP/1.1 200 OK\r\nServer: http-c-erver");
+  expect_true(str->str != start);
+  expect_equal(number, 4, "4096");
+
+  string *negative = int_to_string_arena(&arena, -404);
+  expect_equal(negative, 4, "-404");
+
+  string *copy = str_cpy_arena(&arena, "Content-Length: ", 16);
+  str_cat_arena(&arena, copy, get_char_str(number), get_length(number));
+  expect_equal(copy, 20, "Content-Length: 4096");
+
+  release_arena(&arena);
+
+  // without an arena the strings are allocated on the heap
+  string *heap = str_cpy_arena(NULL, "a", 1);
+  str_cat_arena(NULL, heap, "b", 1);
+  expect_equal(heap, 2, "ab");
+  free_str(heap);
+
+  free_buffer_pool(&pool);
+}
+
+void run_arena_test() {
+  test_arena_alloc();
+  test_str_arena();
+}
@@ -0,0 +1,7 @@
+#ifndef ARENA_TEST_H
+#define ARENA_TEST_H
+
+/// @brief Runs the tests
+void run_arena_test();
+
+#endif
@@ -0,0 +1,68 @@
+#include "buffer_pool_test.h"
+#include "../../../lib/buffer_pool/buffer_pool.h"
+#include "../../../lib/string_lib/string_lib.h"
+#include "../../../lib/testing/unit/test-lib.h"
+
+void test_acquire_buffer() {
+  test_title("Test acquire_buffer() and release_buffer()");
+
+  buffer_pool *pool = new_buffer_pool();
+  expect_not_null(pool);
+
+  buffer_t *buffer = acquire_buffer(pool, 100);
+  expect_not_null(buffer);
+  expect_true(buffer->capacity == BUFFER_POOL_MIN_SIZE);
+  expect_true(buffer->length == 0);
+
+  // a released buffer is reused
+  buffer_t *released = buffer;
+  release_buffer(pool, &buffer);
+  expect_null(buffer);
+
+  buffer = acquire_buffer(pool, BUFFER_POOL_MIN_SIZE);
+  expect_true(buffer == released);
+  release_buffer(pool, &buffer);
+
+  // buffers larger than the largest class are not pooled
+  buffer = acquire_buffer(pool, 1000000);
+  expect_true(buffer->capacity == 1000000);
+  release_buffer(pool, &buffer);
+
+  free_buffer_pool(&pool);
+  expect_null(pool);
+}
+
+void test_buffer_append() {
+  test_title("Test buffer_append() and buffer_consume()");
+
+  buffer_pool *pool = new_buffer_pool();
+  buffer_t *buffer = NULL;
+
+  expect_true(buffer_append(pool, &buffer, "GET / HTTP/1.1\r\n\r\n", 18));
+  expect_not_null(buffer);
+
+  string data = buffer_string(buffer);
+  expect_equal(&data, 18, "GET / HTTP/1.1\r\n\r\n");
+
+  // the content is kept when the buffer grows
+  char large[BUFFER_POOL_MIN_SIZE];
+  memset(large, 'a', sizeof(large));
+  expect_true(buffer_append(pool, &buffer, large, sizeof(large)));
+  expect_true(buffer->capacity == BUFFER_POOL_MIN_SIZE * 2);
+  expect_true(buffer->length == 18 + BUFFER_POOL_MIN_SIZE);
+
+  buffer_consume(buffer, 18 + BUFFER_POOL_MIN_SIZE - 1);
+  data = buffer_string(buffer);
+  expect_equal(&data, 1, "a");
+
+  buffer_consume(buffer, 1);
+  expect_true(buffer->length == 0);
+
+  release_buffer(pool, &buffer);
+  free_buffer_pool(&pool);
+}
+
+void run_buffer_pool_test() {
+  test_acquire_buffer();
+  test_buffer_append();
+}
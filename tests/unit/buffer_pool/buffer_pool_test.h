@@ -0,0 +1,7 @@
+#ifndef BUFFER_POOL_TEST_H
+#define BUFFER_POOL_TEST_H
+
+/// @brief Runs the tests
+void run_buffer_pool_test();
+
+#endif
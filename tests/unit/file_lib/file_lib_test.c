@@ -0,0 +1,306 @@
+#define _GNU_SOURCE
+
+#include "file_lib_test.h"
+#include "../../../lib/file_lib/file_lib.h"
+#include "../../../lib/string_lib/string_lib.h"
+#include "../../../lib/testing/unit/test-lib.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+ * @brief Create a temporary file with the given content
+ *
+ * @param content The content of the file
+ * @return The path of the file (must be freed and unlinked after use)
+ */
+static string *temporary_file(const char *content) {
+  char path[] = "/tmp/file_lib_test_XXXXXX";
+  int fd = mkstemp(path);
+
+  write(fd, content, strlen(content));
+  close(fd);
+
+  return str_cpy(path, strlen(path));
+}
+
+/**
+ * @brief Open a file and insert it into the cache
+ */
+static file_cache_entry *insert_file(file_cache *cache, string *path) {
+  size_t size = 0;
+  int fd = open_file(path, &size);
+
+  file_cache_entry *entry = file_cache_insert(cache, path, fd, str_cpy("header", 6));
+  close(fd);
+
+  return entry;
+}
+
+void test_open_file() {
+  test_title("Test open_file()");
+
+  string *path = temporary_file("content");
+  size_t size = 0;
+
+  int fd = open_file(path, &size);
+  expect_true(fd >= 0);
+  expect_true(size == 7);
+  close(fd);
+
+  // directories are not opened
+  string *directory = str_cpy("/tmp", 4);
+  expect_true(open_file(directory, &size) == -1);
+  expect_true(open_file(NULL, &size) == -1);
+
+  unlink(get_char_str(path));
+  free_str(path);
+  free_str(directory);
+}
+
+void test_open_file_beneath() {
+  test_title("Test open_file_beneath()");
+
+  char root[] = "/tmp/file_lib_test_XXXXXX";
+  expect_not_null(mkdtemp(root));
+
+  string *outside = temporary_file("outside");
+  int root_fd = open(root, O_PATH | O_DIRECTORY | O_CLOEXEC);
+  expect_true(root_fd >= 0);
+
+  // a file and a link that stays beneath the root are opened
+  int fd = openat(root_fd, "file", O_WRONLY | O_CREAT | O_CLOEXEC, 0600);
+  write(fd, "content", 7);
+  close(fd);
+  mkdirat(root_fd, "directory", 0700);
+  symlinkat("../file", root_fd, "directory/inside");
+  symlinkat(get_char_str(outside), root_fd, "outside");
+
+  size_t size = 0;
+  fd = open_file_beneath(root_fd, "file", &size);
+  expect_true(fd >= 0);
+  expect_true(size == 7);
+  close(fd);
+
+  fd = open_file_beneath(root_fd, "directory/../directory/inside", &size);
+  expect_true(fd >= 0);
+  close(fd);
+
+  // paths that leave the root are rejected by the kernel
+  expect_true(open_file_beneath(root_fd, "../file", &size) == -1);
+  expect_true(errno == EXDEV);
+  expect_true(open_file_beneath(root_fd, "outside", &size) == -1);
+  expect_true(errno == EXDEV);
+  expect_true(open_file_beneath(root_fd, get_char_str(outside), &size) == -1);
+  expect_true(errno == EXDEV);
+
+  // directories and missing files are not opened
+  expect_true(open_file_beneath(root_fd, "directory", &size) == -1);
+  expect_true(open_file_beneath(root_fd, "", &size) == -1);
+  expect_true(open_file_beneath(root_fd, "missing", &size) == -1);
+  expect_true(errno == ENOENT);
+  expect_true(open_file_beneath(root_fd, NULL, &size) == -1);
+
+  unlinkat(root_fd, "outside", 0);
+  unlinkat(root_fd, "directory/inside", 0);
+  unlinkat(root_fd, "directory", AT_REMOVEDIR);
+  unlinkat(root_fd, "file", 0);
+  close(root_fd);
+  rmdir(root);
+  unlink(get_char_str(outside));
+  free_str(outside);
+}
+
+void test_file_cache() {
+  test_title("Test file_cache_lookup() and file_cache_insert()");
+
+  file_cache *cache = new_file_cache(1024, 1024, 0, 0, 60, 60);
+  string *path = temporary_file("content");
+
+  expect_null(file_cache_lookup(cache, path));
+
+  file_cache_entry *entry = insert_file(cache, path);
+  expect_not_null(entry);
+  expect_equal(entry->content, 7, "content");
+  expect_equal(entry->header, 6, "header");
+  expect_true(cache->size == 13);
+  release_file_cache_entry(&entry);
+  expect_null(entry);
+
+  // a hit is served from memory, changes are not noticed before the revalidation interval
+  int fd = open(get_char_str(path), O_WRONLY | O_TRUNC);
+  write(fd, "changed!", 8);
+  close(fd);
+
+  entry = file_cache_lookup(cache, path);
+  expect_not_null(entry);
+  expect_equal(entry->content, 7, "content");
+  release_file_cache_entry(&entry);
+
+  // the changed file is dropped once the entry is revalidated
+  cache->revalidate_interval = 0;
+  expect_null(file_cache_lookup(cache, path));
+  expect_true(cache->size == 0);
+
+  unlink(get_char_str(path));
+  free_str(path);
+  free_file_cache(&cache);
+  expect_null(cache);
+}
+
+void test_file_cache_eviction() {
+  test_title("Test file_cache_insert() eviction");
+
+  file_cache *cache = new_file_cache(32, 16, 0, 0, 60, 60);
+  string *first = temporary_file("first file");
+  string *second = temporary_file("second file");
+  string *large = temporary_file("a file that is too large");
+
+  // files larger than the maximum file size are not cached
+  expect_null(insert_file(cache, large));
+
+  file_cache_entry *entry = insert_file(cache, first);
+  expect_not_null(entry);
+
+  // the least recently used entry is evicted, but stays valid until it is released
+  file_cache_entry *second_entry = insert_file(cache, second);
+  expect_not_null(second_entry);
+  expect_true(cache->size == 17);
+  expect_null(file_cache_lookup(cache, first));
+  expect_false(entry->cached);
+  expect_equal(entry->content, 10, "first file");
+
+  release_file_cache_entry(&entry);
+  release_file_cache_entry(&second_entry);
+
+  unlink(get_char_str(first));
+  unlink(get_char_str(second));
+  unlink(get_char_str(large));
+  free_str(first);
+  free_str(second);
+  free_str(large);
+  free_file_cache(&cache);
+}
+
+void test_file_cache_descriptors() {
+  test_title("Test file_cache_insert_descriptor()");
+
+  file_cache *cache = new_file_cache(16, 16, 1, 0, 60, 60);
+  string *first = temporary_file("a file that is too large");
+  string *second = temporary_file("another file that is too large");
+  size_t size = 0;
+
+  // a cache without descriptors keeps nothing open
+  file_cache *no_descriptors = new_file_cache(16, 16, 0, 0, 60, 60);
+  int fd = open_file(first, &size);
+  expect_null(file_cache_insert_descriptor(no_descriptors, first, fd, NULL));
+  close(fd);
+  free_file_cache(&no_descriptors);
+
+  fd = open_file(first, &size);
+  file_cache_entry *entry = file_cache_insert_descriptor(cache, first, fd, str_cpy("header", 6));
+  expect_not_null(entry);
+  expect_null(entry->content);
+  expect_true(entry->fd == fd);
+  expect_true(entry->size == 24);
+  expect_true(cache->descriptor_count == 1);
+  // descriptors do not count against the memory budget
+  expect_true(cache->size == 0);
+  release_file_cache_entry(&entry);
+
+  // a hit uses the open file
+  entry = file_cache_lookup(cache, first);
+  expect_not_null(entry);
+  expect_true(entry->fd == fd);
+
+  // the least recently used descriptor is evicted, but stays open until it is released
+  int second_fd = open_file(second, &size);
+  file_cache_entry *second_entry =
+      file_cache_insert_descriptor(cache, second, second_fd, str_cpy("header", 6));
+  expect_not_null(second_entry);
+  expect_true(cache->descriptor_count == 1);
+  expect_null(file_cache_lookup(cache, first));
+  expect_false(entry->cached);
+  expect_true(fcntl(fd, F_GETFD) != -1);
+  release_file_cache_entry(&entry);
+  expect_true(fcntl(fd, F_GETFD) == -1);
+  release_file_cache_entry(&second_entry);
+
+  // a file that has been replaced is opened again once the entry is revalidated
+  string *replacement = temporary_file("the replaced file is too large!");
+  rename(get_char_str(replacement), get_char_str(second));
+  cache->revalidate_interval = 0;
+  expect_null(file_cache_lookup(cache, second));
+  expect_true(cache->descriptor_count == 0);
+
+  unlink(get_char_str(first));
+  unlink(get_char_str(second));
+  free_str(first);
+  free_str(second);
+  free_str(replacement);
+  free_file_cache(&cache);
+}
+
+void test_file_cache_negatives() {
+  test_title("Test file_cache_insert_negative()");
+
+  file_cache *cache = new_file_cache(16, 16, 0, 1, 60, 60);
+  string *first = str_cpy("/missing/first", 14);
+  string *second = str_cpy("/missing/second", 15);
+
+  // a cache without negative entries remembers nothing
+  file_cache *no_negatives = new_file_cache(16, 16, 0, 0, 60, 60);
+  expect_null(file_cache_insert_negative(no_negatives, first, ENOENT));
+  free_file_cache(&no_negatives);
+  expect_null(file_cache_insert_negative(cache, first, 0));
+  // transient errors say nothing about the path and are not remembered
+  expect_false(is_cacheable_lookup_error(EMFILE));
+  expect_null(file_cache_insert_negative(cache, first, EMFILE));
+  expect_null(file_cache_insert_negative(cache, first, EINTR));
+  expect_true(cache->negative_count == 0);
+  expect_null(file_cache_lookup(cache, first));
+
+  file_cache_entry *entry = file_cache_insert_negative(cache, first, ENOENT);
+  expect_not_null(entry);
+  expect_true(entry->error == ENOENT);
+  expect_true(entry->fd == -1);
+  expect_null(entry->content);
+  expect_true(cache->negative_count == 1);
+  // negative entries do not count against the memory budget
+  expect_true(cache->size == 0);
+  release_file_cache_entry(&entry);
+
+  // a hit is answered without touching the file system (the path does not exist)
+  entry = file_cache_lookup(cache, first);
+  expect_not_null(entry);
+  expect_true(entry->error == ENOENT);
+  release_file_cache_entry(&entry);
+
+  // the least recently used negative entry is evicted
+  entry = file_cache_insert_negative(cache, second, EACCES);
+  expect_not_null(entry);
+  expect_true(cache->negative_count == 1);
+  expect_null(file_cache_lookup(cache, first));
+  release_file_cache_entry(&entry);
+
+  // expired entries are dropped
+  cache->negative_ttl = 0;
+  expect_null(file_cache_lookup(cache, second));
+  expect_true(cache->negative_count == 0);
+
+  free_str(first);
+  free_str(second);
+  free_file_cache(&cache);
+}
+
+void run_file_lib_test() {
+  test_open_file();
+  test_open_file_beneath();
+  test_file_cache();
+  test_file_cache_eviction();
+  test_file_cache_descriptors();
+  test_file_cache_negatives();
+}
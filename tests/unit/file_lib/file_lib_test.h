@@ -0,0 +1,7 @@
+#ifndef FILE_LIB_TEST_H
+#define FILE_LIB_TEST_H
+
+/// @brief Runs the tests
+void run_file_lib_test();
+
+#endif
@@ -1,6 +1,7 @@
 #include "http-lib_test.h"
 #include "../../../lib/string_lib/string_lib.h"
 #include "../../../lib/testing/unit/test-lib.h"
+#include <stdbool.h>
 
 void test_str_cat() {
   test_title("Test str_cat()");
@@ -36,6 +37,60 @@ void test_str_set() {
   free_str(string);
 }
 
+void test_str_capacity() {
+  test_title("Test str_reserve(), str_clear() and str_truncate()");
+
+  string *str = _new_string();
+
+  // appending byte by byte grows the allocation geometrically
+  size_t resized = 0;
+  size_t capacity = str->capacity;
+
+  for (size_t i = 0; i < 1000; i++) {
+    str_cat(str, "a", 1);
+
+    if (str->capacity != capacity) {
+      capacity = str->capacity;
+      resized++;
+    }
+  }
+
+  expect_true(get_length(str) == 1000);
+  expect_true(resized <= 8);
+
+  // the allocation is kept when the content gets shorter
+  str_set(str, "Hello", 5);
+  expect_equal(str, 5, "Hello");
+  expect_true(str->capacity == capacity);
+
+  str_truncate(str, 4);
+  expect_equal(str, 4, "Hell");
+  str_truncate(str, 10);
+  expect_equal(str, 4, "Hell");
+
+  str_clear(str);
+  expect_equal(str, 0, "");
+  expect_true(str->capacity == capacity);
+
+  str_reserve(str, 5000);
+  expect_true(str->capacity == 5001);
+  char *reserved = str->str;
+  str_cat(str, "world", 5);
+  expect_equal(str, 5, "world");
+  expect_true(str->str == reserved);
+
+  free_str(str);
+
+  // a string that does not own its data copies it before it is changed
+  char data[] = "borrowed";
+  string borrowed = {.len = 8, .str = data};
+  str_cat(&borrowed, "!", 1);
+  expect_equal(&borrowed, 9, "borrowed!");
+  expect_true(borrowed.str != data);
+  expect_true(strcmp(data, "borrowed") == 0);
+  free(borrowed.str);
+}
+
 void test_new_string() {
   test_title("Test new_string()");
 
@@ -69,6 +124,105 @@ void test_str_str() {
   free_str(needle);
 }
 
+void test_str_find() {
+  test_title("Test str_find_any(), str_find_control(), str_find() and str_find_ignore_case()");
+
+  str_simd_level selected = get_str_simd_level();
+  char data[70];
+  str_view view = {.str = data, .len = sizeof(data)};
+  str_view needle = {.str = "aab", .len = 3};
+  str_view header = {.str = "host:", .len = 5};
+
+  // every instruction set finds the same positions, also in the scalar rest after the blocks
+  for (str_simd_level level = STR_SIMD_SCALAR; level <= STR_SIMD_AVX2; level++) {
+    set_str_simd_level(level);
+    bool found_any = true;
+    bool found_control = true;
+    bool found = true;
+    bool found_ignore_case = true;
+
+    for (size_t i = 0; i + 5 <= sizeof(data); i++) {
+      memset(data, 'a', sizeof(data));
+      data[i] = i % 2 == 0 ? ':' : '\0';
+
+      // all lengths, the match is the last byte of the prefix
+      str_view prefix = {.str = data, .len = i + 1};
+      found_any &= str_find_any(view, " :\r\0", 4) == data + i;
+      found_any &= str_find_any(prefix, " :\r\0", 4) == data + i;
+
+      data[i] = i % 2 == 0 ? '\t' : 0x7f;
+      found_control &= str_find_control(view) == data + i;
+      found_control &= str_find_control(prefix) == data + i;
+
+      // every position before the needle is a candidate (first and last byte match)
+      memset(data, 'a', sizeof(data));
+      data[i + 2] = 'b';
+      data[i + 4] = 'b';
+      found &= str_find(view, needle) == data + i;
+
+      memset(data, 'x', sizeof(data));
+      memcpy(data + i, "HoSt:", 5);
+      found_ignore_case &= str_find_ignore_case(view, header) == data + i;
+    }
+
+    memset(data, (char)0x80, sizeof(data));
+    expect_true(found_any && str_find_any(view, " :\r\0", 4) == NULL);
+    expect_true(found_control && str_find_control(view) == NULL);
+    expect_true(found && str_find(view, needle) == NULL);
+    expect_true(found_ignore_case && str_find_ignore_case(view, header) == NULL);
+  }
+
+  set_str_simd_level(selected);
+}
+
+void test_str_view() {
+  test_title("Test str_view_cmp(), str_view_case_cmp() and str_view_trim()");
+
+  string *str = str_cpy(" \tKeep-Alive ", 13);
+  str_view view = str_view_of(str);
+  expect_true(view.str == str->str && view.len == 13);
+
+  view = str_view_trim(view);
+  expect_true(view.len == 10);
+  expect_true(str_view_cmp(view, "Keep-Alive") == 0);
+  expect_true(str_view_cmp(view, "keep-alive") != 0);
+  expect_true(str_view_case_cmp(view, "keep-alive") == 0);
+  expect_true(str_view_case_cmp(view, "keep-alive2") != 0);
+  // only ASCII letters are folded, other bytes never match regardless of the locale
+  expect_true(str_view_case_cmp(STR_VIEW_LITERAL("\xC4"), "\xE4") != 0);
+  expect_true(str_view_of(NULL).len == 0);
+  expect_true(str_view_equal(view, STR_VIEW_LITERAL("Keep-Alive")));
+  expect_false(str_view_equal(view, STR_VIEW_LITERAL("Keep-Alive ")));
+
+  free_str(str);
+}
+
+void test_str_literal() {
+  test_title("Test STR_LITERAL() and str_borrow()");
+
+  // the length is known at compile time, the data is not copied
+  static const char text[] = "text/html";
+  string literal = STR_LITERAL("text/html");
+  expect_equal(&literal, 9, "text/html");
+  expect_true(literal.capacity == 0);
+  expect_true(STR_LITERAL_LEN("\r\n\r\n") == 4);
+  expect_true(str_str(&STR_LITERAL("/default/index.html"), &STR_LITERAL("index")) != NULL);
+
+  // a borrowed string is copied once it is changed, its data is never freed
+  string *str = str_cpy("a string that does not fit inline", 33);
+  str_borrow(str, text, 9);
+  expect_true(str->str == text && str->capacity == 0);
+  expect_equal(str, 9, "text/html");
+
+  str_cat(str, "; charset=utf-8", 15);
+  expect_equal(str, 24, "text/html; charset=utf-8");
+  expect_true(str->str != text);
+  expect_true(strcmp(text, "text/html") == 0);
+
+  str_borrow(str, text, 9);
+  free_str(str);
+}
+
 void test_get_length() {
   test_title("Test get_length()");
 
@@ -116,9 +270,13 @@ void test_size_t_to_string() {
 void run_httplib_test() {
   test_str_cat();
   test_str_set();
+  test_str_capacity();
   test_new_string();
   test_cpy_str();
   test_str_str();
+  test_str_find();
+  test_str_view();
+  test_str_literal();
   test_get_length();
   test_get_char_str();
   test_int_to_string();
@@ -0,0 +1,260 @@
+#include "http_connection_test.h"
+#include "../../../lib/testing/unit/test-lib.h"
+#include "../../../main.h"
+#include "../../../src/http_connection/http_connection.h"
+#include <stdlib.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+/**
+ * @brief Handler that echoes the request back to the client and keeps the connection open
+ *
+ * The response is allocated from the arena of the connection.
+ */
+static encoded_response_t *echo_handler(string *request, bool *keep_alive, arena *arena) {
+  (void)keep_alive;
+
+  encoded_response_t *response = new_encoded_response_arena(arena);
+  str_cat_arena(arena, response->head, get_char_str(request), get_length(request));
+
+  return response;
+}
+
+/**
+ * @brief Handler that rejects every request and closes the connection
+ */
+static encoded_response_t *reject_handler(string *request, bool *keep_alive, arena *arena) {
+  (void)request;
+  (void)arena;
+  *keep_alive = false;
+
+  encoded_response_t *response = new_encoded_response();
+  str_set(response->head, "431", 3);
+
+  return response;
+}
+
+void test_connection_read() {
+  test_title("Test connection_read()");
+
+  int fds[2];
+  buffer_pool *pool = new_buffer_pool();
+  socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds);
+
+  connection_t *connection = new_connection(fds[0], pool);
+  expect_not_null(connection);
+
+  // nothing available yet, no buffer is held
+  expect_true(connection_read(connection) == CONNECTION_READING);
+  expect_null(connection->in);
+
+  write(fds[1], "GET / HTTP/1.1\r\n", 16);
+  expect_true(connection_read(connection) == CONNECTION_READING);
+  string received = buffer_string(connection->in);
+  expect_equal(&received, 16, "GET / HTTP/1.1\r\n");
+
+  // the client closed the connection
+  close(fds[1]);
+  release_buffer(pool, &connection->in);
+  expect_true(connection_read(connection) == CONNECTION_CLOSED);
+
+  free_connection(&connection);
+  expect_null(connection);
+  free_buffer_pool(&pool);
+}
+
+void test_handle_connection() {
+  test_title("Test handle_connection()");
+
+  int fds[2];
+  char buffer[64] = {0};
+  buffer_pool *pool = new_buffer_pool();
+  socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds);
+
+  connection_t *connection = new_connection(fds[0], pool);
+
+  // incomplete requests are not processed
+  write(fds[1], "ping", 4);
+  expect_true(handle_connection(connection, echo_handler) == CONNECTION_READING);
+  expect_true(connection->requests == 0);
+
+  write(fds[1], "\r\n\r\n", 4);
+  expect_true(handle_connection(connection, echo_handler) == CONNECTION_READING);
+  expect_true(connection->requests == 1);
+
+  string *response = str_cpy(buffer, read(fds[1], buffer, sizeof(buffer)));
+  expect_equal(response, 8, "ping\r\n\r\n");
+  free_str(response);
+
+  // an incomplete request is processed once the client closed its side
+  write(fds[1], "pong", 4);
+  shutdown(fds[1], SHUT_WR);
+  expect_true(handle_connection(connection, echo_handler) == CONNECTION_CLOSED);
+
+  response = str_cpy(buffer, read(fds[1], buffer, sizeof(buffer)));
+  expect_equal(response, 4, "pong");
+
+  free_str(response);
+  free_connection(&connection);
+  free_buffer_pool(&pool);
+  close(fds[1]);
+}
+
+void test_connection_sent() {
+  test_title("Test connection_output() and connection_sent()");
+
+  connection_t *connection = new_connection(-1, NULL);
+
+  // two queued responses: head and body, head only
+  encoded_response_t *first = new_encoded_response();
+  str_set(first->head, "head1", 5);
+  first->body = str_cpy("body1", 5);
+
+  encoded_response_t *second = new_encoded_response();
+  str_set(second->head, "head2", 5);
+
+  connection->out = first;
+  first->next = second;
+  connection->out_tail = second;
+  connection->keep_alive = true;
+
+  struct msghdr *message = connection_output(connection);
+  expect_true(message->msg_iovlen == 3);
+
+  // a partial write resumes in the middle of a segment
+  expect_true(connection_sent(connection, 7) == CONNECTION_WRITING);
+  message = connection_output(connection);
+  expect_true(message->msg_iovlen == 2);
+  expect_true(message->msg_iov[0].iov_len == 3);
+
+  string rest = {.len = 3, .str = message->msg_iov[0].iov_base};
+  expect_equal(&rest, 3, "dy1");
+
+  // the first response is freed once it has been sent completely
+  expect_true(connection_sent(connection, 3) == CONNECTION_WRITING);
+  expect_true(connection->out == second);
+  expect_true(connection_output(connection)->msg_iovlen == 1);
+
+  expect_true(connection_sent(connection, 5) == CONNECTION_READING);
+  expect_null(connection->out);
+
+  free_connection(&connection);
+}
+
+void test_connection_write_file() {
+  test_title("Test connection_write() with a file body");
+
+  int fds[2];
+  char buffer[64] = {0};
+  char path[] = "/tmp/http_connection_test_XXXXXX";
+  socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds);
+
+  int file_fd = mkstemp(path);
+  unlink(path);
+  write(file_fd, "file body", 9);
+
+  connection_t *connection = new_connection(fds[0], NULL);
+
+  // a file response is followed by a head only response
+  encoded_response_t *first = new_encoded_response();
+  str_set(first->head, "head1", 5);
+  first->file_fd = file_fd;
+  first->file_offset = 5;
+  first->file_length = 4;
+
+  encoded_response_t *second = new_encoded_response();
+  str_set(second->head, "head2", 5);
+
+  connection->out = first;
+  first->next = second;
+  connection->out_tail = second;
+
+  off_t offset = 0;
+  size_t length = 0;
+
+  // the segments end before the file body
+  expect_true(connection_output(connection)->msg_iovlen == 1);
+  expect_true(connection_output_file(connection, &offset, &length) == -1);
+
+  // the head has been sent, the file body is next
+  expect_true(connection_sent(connection, 5) == CONNECTION_WRITING);
+  expect_true(connection_output(connection)->msg_iovlen == 0);
+  expect_true(connection_output_file(connection, &offset, &length) == file_fd);
+  expect_true(offset == 5 && length == 4);
+
+  expect_true(connection_write(connection) == CONNECTION_CLOSED);
+  expect_null(connection->out);
+
+  string *response = str_cpy(buffer, read(fds[1], buffer, sizeof(buffer)));
+  expect_equal(response, 9, "bodyhead2");
+
+  free_str(response);
+  free_connection(&connection);
+  close(fds[1]);
+}
+
+void test_handle_connection_pipelined() {
+  test_title("Test handle_connection() with pipelined requests");
+
+  int fds[2];
+  char buffer[64] = {0};
+  buffer_pool *pool = new_buffer_pool();
+  socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds);
+
+  connection_t *connection = new_connection(fds[0], pool);
+
+  // two complete requests and the start of a third one
+  write(fds[1], "a\r\n\r\nb\r\n\r\nc", 11);
+  expect_true(handle_connection(connection, echo_handler) == CONNECTION_READING);
+  expect_true(connection->requests == 2);
+  string rest = buffer_string(connection->in);
+  expect_equal(&rest, 1, "c");
+
+  string *response = str_cpy(buffer, read(fds[1], buffer, sizeof(buffer)));
+  expect_equal(response, 10, "a\r\n\r\nb\r\n\r\n");
+
+  free_str(response);
+  free_connection(&connection);
+  free_buffer_pool(&pool);
+  close(fds[1]);
+}
+
+void test_handle_connection_oversized() {
+  test_title("Test handle_connection() with an oversized request head");
+
+  int fds[2];
+  char buffer[64] = {0};
+  char head[HTTP_MAX_REQUEST_SIZE + 1];
+  buffer_pool *pool = new_buffer_pool();
+  socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds);
+
+  connection_t *connection = new_connection(fds[0], pool);
+
+  // a head of HTTP_MAX_REQUEST_SIZE bytes may still be completed
+  memset(head, 'a', sizeof(head));
+  write(fds[1], head, HTTP_MAX_REQUEST_SIZE);
+  expect_true(handle_connection(connection, reject_handler) == CONNECTION_READING);
+  expect_true(connection->requests == 0);
+
+  // the head is rejected without waiting for its end
+  write(fds[1], head, 1);
+  expect_true(handle_connection(connection, reject_handler) == CONNECTION_CLOSED);
+  expect_true(connection->requests == 1);
+
+  string *response = str_cpy(buffer, read(fds[1], buffer, sizeof(buffer)));
+  expect_equal(response, 3, "431");
+
+  free_str(response);
+  free_connection(&connection);
+  free_buffer_pool(&pool);
+  close(fds[1]);
+}
+
+void run_http_connection_test() {
+  test_connection_read();
+  test_handle_connection();
+  test_connection_sent();
+  test_connection_write_file();
+  test_handle_connection_pipelined();
+  test_handle_connection_oversized();
+}
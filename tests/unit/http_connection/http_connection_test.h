@@ -0,0 +1,7 @@
+#ifndef HTTP_CONNECTION_TEST_H
+#define HTTP_CONNECTION_TEST_H
+
+/// @brief Runs the tests
+void run_http_connection_test();
+
+#endif
@@ -19,8 +19,168 @@ void test_parse_request_string() {
   free_str(raw_request);
 }
 
-void test_serialize_response() {
-  test_title("Test serialize_response()");
+void test_parse_request_view() {
+  test_title("Test parse_request_view()");
+
+  string *raw_request =
+      str_cpy("GET /index.html HTTP/1.0\r\nX-Host: other\r\nHOST:  extern \r\n"
+              "Connection: keep-alive\r\n\r\n",
+              83);
+  request_view request;
+
+  expect_true(parse_request_view(raw_request, &request) == EXIT_SUCCESS);
+
+  // the fields point into the raw request
+  expect_true(request.method.str == raw_request->str);
+  expect_true(str_view_cmp(request.resource, "/index.html") == 0);
+  expect_true(request.method_id == REQUEST_METHOD_GET);
+  expect_true(request.version_id == REQUEST_VERSION_1_0);
+  expect_true(str_view_cmp(get_request_header(&request, REQUEST_HEADER_HOST), "extern") == 0);
+  expect_true(
+      str_view_cmp(get_request_header(&request, REQUEST_HEADER_CONNECTION), "keep-alive") == 0);
+  expect_true(get_request_header(&request, REQUEST_HEADER_ACCEPT).len == 0);
+
+  // every header line is kept
+  expect_true(request.header_count == 3);
+  expect_true(request.headers[0].id == REQUEST_HEADER_UNKNOWN);
+  expect_true(str_view_cmp(request.headers[0].name, "X-Host") == 0);
+  expect_true(str_view_cmp(request.headers[0].value, "other") == 0);
+  expect_true(request.headers[1].id == REQUEST_HEADER_HOST);
+
+  str_set(raw_request, "DELETE / HTTP/2\r\n\r\n", 19);
+  expect_true(parse_request_view(raw_request, &request) == EXIT_SUCCESS);
+  expect_true(request.method_id == REQUEST_METHOD_DELETE);
+  expect_true(request.version_id == REQUEST_VERSION_UNKNOWN);
+
+  // more than three segments
+  str_set(raw_request, "GET / HTTP/1.1 x\r\n\r\n", 20);
+  expect_true(parse_request_view(raw_request, &request) == EXIT_FAILURE);
+
+  free_str(raw_request);
+}
+
+void test_parse_request_headers() {
+  test_title("Test parse_request_view() headers");
+
+  const char *raw = "GET / HTTP/1.1\r\nHost : space\r\n\tHost: folded\r\nAccept: a\x01z\r\n"
+                    "User-Agent:curl\nAccept:  */* \r\nHost: cut\r\r\nHost: valid\r\n\r\n"
+                    "Host: body\r\n";
+  string *raw_request = str_cpy(raw, strlen(raw));
+  request_view request;
+
+  // malformed lines are skipped, the first valid occurrence is used
+  expect_true(parse_request_view(raw_request, &request) == EXIT_SUCCESS);
+  expect_true(str_view_cmp(get_request_header(&request, REQUEST_HEADER_HOST), "valid") == 0);
+  expect_true(str_view_cmp(get_request_header(&request, REQUEST_HEADER_ACCEPT), "*/*") == 0);
+  expect_true(str_view_cmp(get_request_header(&request, REQUEST_HEADER_USER_AGENT), "curl") == 0);
+  expect_true(request.header_count == 3);
+
+  // a cut off line is ignored
+  str_set(raw_request, "GET / HTTP/1.1\r\nConnection: close", 33);
+  expect_true(parse_request_view(raw_request, &request) == EXIT_SUCCESS);
+  expect_true(request.header_count == 0);
+
+  free_str(raw_request);
+}
+
+void test_parse_request_header_name() {
+  test_title("Test parse_request_header_name()");
+
+  // every known name is found in the perfect hash table
+  for (request_header header = REQUEST_HEADER_UNKNOWN + 1; header < REQUEST_HEADER_COUNT;
+       header++) {
+    const char *name = get_request_header_name(header);
+    str_view view = {.str = name, .len = strlen(name)};
+
+    expect_true(parse_request_header_name(view) == header);
+  }
+
+  str_view if_none_match = {.str = "IF-NONE-MATCH", .len = 13};
+  str_view x_host = {.str = "X-Host", .len = 6};
+  str_view hosts = {.str = "hosts", .len = 5};
+  str_view empty = {.str = "", .len = 0};
+
+  expect_true(parse_request_header_name(if_none_match) == REQUEST_HEADER_IF_NONE_MATCH);
+  expect_true(parse_request_header_name(x_host) == REQUEST_HEADER_UNKNOWN);
+  expect_true(parse_request_header_name(hosts) == REQUEST_HEADER_UNKNOWN);
+  expect_true(parse_request_header_name(empty) == REQUEST_HEADER_UNKNOWN);
+  expect_true(get_request_header_name(REQUEST_HEADER_UNKNOWN) == NULL);
+
+  // too many header lines
+  string *raw_request = str_cpy("GET / HTTP/1.1\r\n", 16);
+
+  for (size_t i = 0; i <= REQUEST_MAX_HEADERS; i++) {
+    raw_request = str_cat(raw_request, "Range: bytes=0-\r\n", 17);
+  }
+
+  request_view request;
+
+  expect_true(parse_request_view(raw_request, &request) == EXIT_SUCCESS);
+  expect_true(request.header_overflow);
+  expect_true(request.header_count == REQUEST_MAX_HEADERS);
+  expect_true(str_view_cmp(get_request_header(&request, REQUEST_HEADER_RANGE), "bytes=0-") == 0);
+
+  free_str(raw_request);
+}
+
+void test_get_request_length() {
+  test_title("Test get_request_length()");
+
+  string *raw_request = str_cpy("GET / HTTP/1.1\r\n\r\nGET /a HTTP/1.1\r\n\r\nGET", 40);
+
+  expect_true(get_request_length(raw_request, 0) == 18);
+  expect_true(get_request_length(raw_request, 18) == 19);
+  expect_true(get_request_length(raw_request, 37) == 0);
+  expect_true(get_request_length(NULL, 0) == 0);
+
+  free_str(raw_request);
+}
+
+void test_parse_request_incremental() {
+  test_title("Test parse_request_incremental()");
+
+  const char *raw = "GET / HTTP/1.1\r\nHost: localhost\r\n\r\nGET";
+  request_parser parser;
+  reset_request_parser(&parser);
+
+  // the request arrives byte by byte, the end of the head is split across the fragments
+  for (size_t i = 0; i < 34; i++) {
+    expect_true(parse_request_incremental(&parser, raw, i) == REQUEST_PARSE_INCOMPLETE);
+    expect_true(parser.scanned == i);
+  }
+
+  expect_true(parse_request_incremental(&parser, raw, 35) == REQUEST_PARSE_COMPLETE);
+  expect_true(parser.length == 35);
+
+  // the result is kept until the parser is reset
+  expect_true(parse_request_incremental(&parser, raw, 38) == REQUEST_PARSE_COMPLETE);
+  expect_true(parser.length == 35);
+
+  reset_request_parser(&parser);
+  expect_true(parse_request_incremental(&parser, raw + 35, 3) == REQUEST_PARSE_INCOMPLETE);
+
+  // \r\r\n\r\n ends the head as well
+  reset_request_parser(&parser);
+  expect_true(parse_request_incremental(&parser, "GET / HTTP/1.1\r\r\n\r\n", 19) ==
+              REQUEST_PARSE_COMPLETE);
+  expect_true(parser.length == 19);
+
+  // an oversized head is rejected before it is complete
+  char *oversized = malloc(HTTP_MAX_REQUEST_SIZE + 2);
+  memset(oversized, 'a', HTTP_MAX_REQUEST_SIZE + 2);
+  reset_request_parser(&parser);
+
+  expect_true(parse_request_incremental(&parser, oversized, HTTP_MAX_REQUEST_SIZE) ==
+              REQUEST_PARSE_INCOMPLETE);
+  expect_true(parse_request_incremental(&parser, oversized, HTTP_MAX_REQUEST_SIZE + 2) ==
+              REQUEST_PARSE_ERROR);
+  expect_true(parser.error == HTTP_REQUEST_HEADER_FIELDS_TOO_LARGE);
+
+  free(oversized);
+}
+
+void test_encode_response() {
+  test_title("Test encode_response()");
 
   response_t *response = new_response();
   str_set(response->version, HTTP_VERSION_1_1, strlen(HTTP_VERSION_1_1));
@@ -31,14 +191,29 @@ void test_serialize_response() {
   str_set(response->server, SERVER_SIGNATURE, strlen(SERVER_SIGNATURE));
   str_set(response->body, "<h1>Hello World!</h1>", 21);
 
-  string *serialized = serialize_response(response);
+  encoded_response_t *encoded = encode_response(response);
+
+  expect_equal(encoded->head, 94,
+               "HTTP/1.1 200 OK\r\nContent-Type: text/html\r\nContent-Length: 21\r\nServer: "
+               "LLDM/0.1 HTTP Server\r\n\r\n");
+  expect_equal(encoded->body, 21, "<h1>Hello World!</h1>");
+  expect_null(response->body);
+  expect_true(get_encoded_response_length(encoded) == 115);
+
+  free_encoded_response(&encoded);
+  expect_null(encoded);
+
+  response->body = str_cpy("<h1>Hello World!</h1>", 21);
+  update_response_connection(response, true);
+  encoded = encode_response(response);
 
-  expect_equal(serialized, 115,
+  expect_equal(encoded->head, 118,
                "HTTP/1.1 200 OK\r\nContent-Type: text/html\r\nContent-Length: 21\r\nServer: "
-               "LLDM/0.1 HTTP Server\r\n\r\n<h1>Hello World!</h1>");
+               "LLDM/0.1 HTTP Server\r\nConnection: keep-alive\r\n\r\n");
+  expect_equal(encoded->body, 21, "<h1>Hello World!</h1>");
 
   free_response(&response);
-  free_str(serialized);
+  free_encoded_response(&encoded);
 }
 
 void test_decode_url() {
@@ -50,6 +225,32 @@ void test_decode_url() {
 
   expect_equal(decoded, 12, "Hello World!");
 
+  // the decoded string is written over the encoded one
+  char in_place[] = "/a%20b+c";
+  size_t length = 8;
+  expect_true(decode_url_in_place(in_place, &length) == EXIT_SUCCESS);
+  expect_true(length == 6);
+  expect_true(memcmp(in_place, "/a b c", 6) == 0);
+
+  // bytes above 0x7f are kept (UTF-8)
+  char path[] = "/images/ein%20leerzeichen.png?%C3%A4%c3%b6";
+  char buffer[sizeof(path)];
+  expect_true(decode_url_to(buffer, path, strlen(path), &length) == EXIT_SUCCESS);
+  expect_true(length == 32);
+  expect_true(memcmp(buffer, "/images/ein leerzeichen.png?\xc3\xa4\xc3\xb6", 32) == 0);
+
+  // malformed escapes are rejected
+  const char *malformed[] = {"%", "/a%2", "/a%zz", "/a%2g", "/a%00b", "%%41"};
+
+  for (size_t i = 0; i < sizeof(malformed) / sizeof(malformed[0]); i++) {
+    expect_true(decode_url_to(buffer, malformed[i], strlen(malformed[i]), &length) ==
+                EXIT_FAILURE);
+  }
+
+  string *invalid = str_cpy("/a%2", 4);
+  expect_true(decode_url(invalid) == NULL);
+
+  free_str(invalid);
   free_str(str);
   free_str(decoded);
 }
@@ -63,13 +264,30 @@ void test_encode_url() {
 
   expect_equal(encoded, 14, "Hello+World%21");
 
+  // unreserved characters are kept, high bytes are encoded as unsigned bytes
+  string *path = str_cpy("ein leerzeichen-1_2.png~/\xc3\xa4", 27);
+  string *encoded_path = encode_url(path);
+  expect_equal(encoded_path, 33, "ein+leerzeichen-1_2.png~%2F%C3%A4");
+
+  // decoding restores the original
+  string *decoded_path = decode_url(encoded_path);
+  expect_true(decoded_path->len == path->len && memcmp(decoded_path->str, path->str, 27) == 0);
+
+  free_str(path);
+  free_str(encoded_path);
+  free_str(decoded_path);
   free_str(str);
   free_str(encoded);
 }
 
 void run_http_parser_test() {
   test_parse_request_string();
-  test_serialize_response();
+  test_parse_request_view();
+  test_parse_request_headers();
+  test_parse_request_header_name();
+  test_get_request_length();
+  test_parse_request_incremental();
+  test_encode_response();
   test_decode_url();
   test_encode_url();
 }
\ No newline at end of file
@@ -1,27 +1,86 @@
 #include "http_router_test.h"
 #include "../../../lib/testing/unit/test-lib.h"
+#include "../../../src/http_parser/http_parser.h"
 #include "../../../src/http_router/http_router.h"
+#include <stdlib.h>
+#include <string.h>
 
-void test_valid_path() {
-  test_title("Test valid_path()");
+/**
+ * @brief Route a raw request and check the status line of the response
+ *
+ * @param raw_request The raw request
+ * @param status_line The expected status line
+ */
+static void expect_route(const char *raw_request, const char *status_line) {
+  string request_string = {.len = strlen(raw_request), .str = (char *)raw_request};
+  request_view request;
 
-  expect_false(valid_path(NULL, NULL));
+  expect_true(parse_request_view(&request_string, &request) == EXIT_SUCCESS);
 
-  string *path = str_cpy("/home/user/src/htdocs/index.html", 32);
-  string *host_extension = str_cpy("/default", 8);
-  expect_true(valid_path(path, host_extension));
+  encoded_response_t *response = route_request(&request, NULL);
+  expect_not_null(response);
+  expect_true(strncmp(get_char_str(response->head), status_line, strlen(status_line)) == 0);
 
-  str_set(path, "/home/user/src/htdocs/intern/index.html", 39);
-  expect_true(valid_path(path, host_extension));
+  free_encoded_response(&response);
+}
+
+void test_route_request() {
+  test_title("Test route_request()");
+
+  // the document roots are resolved relative to the repository root
+  open_document_roots();
+
+  expect_route("GET /index.html HTTP/1.1\r\n\r\n", "HTTP/1.1 200 OK");
+  expect_route("GET //index.html HTTP/1.1\r\n\r\n", "HTTP/1.1 200 OK");
+  expect_route("GET /index.html HTTP/1.1\r\nHost: extern\r\n\r\n", "HTTP/1.1 200 OK");
+  expect_route("GET /index.html HTTP/1.1\r\nHost: intern\r\n\r\n", "HTTP/1.1 401 Authentication required");
+
+  // directories and missing files are not served
+  expect_route("GET / HTTP/1.1\r\n\r\n", "HTTP/1.1 404 Not Found");
+  expect_route("GET /images HTTP/1.1\r\n\r\n", "HTTP/1.1 404 Not Found");
+  expect_route("GET /missing.html HTTP/1.1\r\n\r\n", "HTTP/1.1 404 Not Found");
+
+  // paths that leave the root of the host are answered like missing files
+  expect_route("GET /../extern/index.html HTTP/1.1\r\n\r\n", "HTTP/1.1 404 Not Found");
+  expect_route("GET /../../main.c HTTP/1.1\r\n\r\n", "HTTP/1.1 404 Not Found");
+  expect_route("GET /images/../../default/index.html HTTP/1.1\r\n\r\n", "HTTP/1.1 404 Not Found");
+
+  free_router_file_cache();
+  close_document_roots();
+}
+
+void test_negative_cache() {
+  test_title("Test route_request() negative cache");
+
+  open_document_roots();
+
+  size_t hits = 0;
+  size_t misses = 0;
+  get_negative_cache_stats(&hits, &misses);
 
-  str_set(path, "home/user/src/htdocs/default/index.html", 39);
-  expect_false(valid_path(path, host_extension));
+  // the first request looks the file up, the repeated ones are answered from the cache
+  expect_route("GET /wp-login.php HTTP/1.1\r\n\r\n", "HTTP/1.1 404 Not Found");
+  expect_route("GET /wp-login.php HTTP/1.1\r\n\r\n", "HTTP/1.1 404 Not Found");
+  expect_route("GET /wp-login.php HTTP/1.1\r\n\r\n", "HTTP/1.1 404 Not Found");
 
-  str_set(path, "/home/user/src/htdocs/default/index.html", 40);
-  expect_true(valid_path(path, host_extension));
+  size_t new_hits = 0;
+  size_t new_misses = 0;
+  get_negative_cache_stats(&new_hits, &new_misses);
+  expect_true(new_misses == misses + 1);
+  expect_true(new_hits == hits + 2);
 
-  free_str(path);
-  free_str(host_extension);
+  // the negative cache is kept per virtual host
+  expect_route("GET /wp-login.php HTTP/1.1\r\nHost: extern\r\n\r\n", "HTTP/1.1 404 Not Found");
+  get_negative_cache_stats(&new_hits, &new_misses);
+  expect_true(new_misses == misses + 2);
+
+  expect_route("GET /stats HTTP/1.1\r\n\r\n", "HTTP/1.1 200 OK");
+
+  free_router_file_cache();
+  close_document_roots();
 }
 
-void run_http_router_test() { test_valid_path(); }
\ No newline at end of file
+void run_http_router_test() {
+  test_route_request();
+  test_negative_cache();
+}
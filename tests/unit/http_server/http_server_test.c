@@ -1,56 +1,91 @@
 #include "http_server_test.h"
+#include "../../../lib/arena/arena.h"
 #include "../../../lib/testing/unit/test-lib.h"
 #include "../../../src/http_server/http_server.h"
 
 void test_get_mime_type() {
   test_title("Test get_mime_type()");
 
-  string *mime_type_text = get_mime_type("index");
-  expect_equal(mime_type_text, strlen(CONTENT_TYPE_TEXT), CONTENT_TYPE_TEXT);
+  string mime_type_text = get_mime_type("index");
+  expect_equal(&mime_type_text, strlen(CONTENT_TYPE_TEXT), CONTENT_TYPE_TEXT);
 
-  string *mime_type_html = get_mime_type("index.html");
-  expect_equal(mime_type_html, strlen(CONTENT_TYPE_HTML), CONTENT_TYPE_HTML);
+  string mime_type_html = get_mime_type("index.html");
+  expect_equal(&mime_type_html, strlen(CONTENT_TYPE_HTML), CONTENT_TYPE_HTML);
 
-  string *mime_type_css = get_mime_type("index.css");
-  expect_equal(mime_type_css, strlen(CONTENT_TYPE_CSS), CONTENT_TYPE_CSS);
+  string mime_type_css = get_mime_type("index.css");
+  expect_equal(&mime_type_css, strlen(CONTENT_TYPE_CSS), CONTENT_TYPE_CSS);
 
-  string *mime_type_js = get_mime_type("index.js");
-  expect_equal(mime_type_js, strlen(CONTENT_TYPE_JS), CONTENT_TYPE_JS);
+  string mime_type_js = get_mime_type("index.js");
+  expect_equal(&mime_type_js, strlen(CONTENT_TYPE_JS), CONTENT_TYPE_JS);
 
-  string *mime_type_jpg = get_mime_type("index.jpg");
-  expect_equal(mime_type_jpg, strlen(CONTENT_TYPE_JPEG), CONTENT_TYPE_JPEG);
+  string mime_type_jpg = get_mime_type("index.jpg");
+  expect_equal(&mime_type_jpg, strlen(CONTENT_TYPE_JPEG), CONTENT_TYPE_JPEG);
 
-  string *mime_type_jpeg = get_mime_type("index.jpeg");
-  expect_equal(mime_type_jpeg, strlen(CONTENT_TYPE_JPEG), CONTENT_TYPE_JPEG);
+  string mime_type_jpeg = get_mime_type("index.jpeg");
+  expect_equal(&mime_type_jpeg, strlen(CONTENT_TYPE_JPEG), CONTENT_TYPE_JPEG);
 
-  string *mime_type_png = get_mime_type("index.png");
-  expect_equal(mime_type_png, strlen(CONTENT_TYPE_PNG), CONTENT_TYPE_PNG);
+  string mime_type_png = get_mime_type("index.png");
+  expect_equal(&mime_type_png, strlen(CONTENT_TYPE_PNG), CONTENT_TYPE_PNG);
 
-  string *mime_type_ico = get_mime_type("index.ico");
-  expect_equal(mime_type_ico, strlen(CONTENT_TYPE_ICO), CONTENT_TYPE_ICO);
+  string mime_type_ico = get_mime_type("index.ico");
+  expect_equal(&mime_type_ico, strlen(CONTENT_TYPE_ICO), CONTENT_TYPE_ICO);
 
-  free_str(mime_type_text);
-  free_str(mime_type_html);
-  free_str(mime_type_css);
-  free_str(mime_type_js);
-  free_str(mime_type_jpg);
-  free_str(mime_type_jpeg);
-  free_str(mime_type_png);
-  free_str(mime_type_ico);
+  // the mime types are static strings
+  expect_true(mime_type_ico.capacity == 0);
+  string mime_type_null = get_mime_type(NULL);
+  expect_equal(&mime_type_null, strlen(CONTENT_TYPE_TEXT), CONTENT_TYPE_TEXT);
 }
 
 void test_error_response() {
   test_title("Test error_response()");
 
-  string *response = error_response(404);
-
-  expect_equal(
-      response, 188,
-      "HTTP/1.1 404 Not Found\r\nContent-Type: text/html\r\nContent-Length: 87\r\nServer: LLDM/0.1 "
-      "HTTP Server\r\n\r\n<html><head><title>Error</title></head><body><h1>404</h1><p>Not "
-      "Found</p></body></html>\r\n");
-
-  free_str(response);
+  encoded_response_t *response = error_response(404, false, NULL);
+
+  expect_equal(response->head, 120,
+               "HTTP/1.1 404 Not Found\r\nContent-Type: text/html\r\nContent-Length: 87\r\nServer: "
+               "LLDM/0.1 HTTP Server\r\nConnection: close\r\n\r\n");
+  expect_equal(response->body, 87,
+               "<html><head><title>Error</title></head><body><h1>404</h1><p>Not Found</p></body>"
+               "</html>");
+
+  free_encoded_response(&response);
+
+  response = error_response(404, true, NULL);
+
+  expect_equal(response->head, 125,
+               "HTTP/1.1 404 Not Found\r\nContent-Type: text/html\r\nContent-Length: 87\r\nServer: "
+               "LLDM/0.1 HTTP Server\r\nConnection: keep-alive\r\n\r\n");
+  expect_equal(response->body, 87,
+               "<html><head><title>Error</title></head><body><h1>404</h1><p>Not Found</p></body>"
+               "</html>");
+
+  // the responses point to the prepared table, they share the body
+  encoded_response_t *other = error_response(404, false, NULL);
+  expect_true(response->body->capacity == 0);
+  expect_true(response->body->str == other->body->str);
+  expect_true(response->head->str != other->head->str);
+  free_encoded_response(&other);
+
+  free_encoded_response(&response);
+
+  // the response of an arena is allocated from the arena
+  buffer_pool *pool = new_buffer_pool();
+  arena arena;
+  init_arena(&arena, pool);
+
+  response = error_response(401, false, &arena);
+  expect_true(response->in_arena);
+  expect_true(str_str(response->head, &STR_LITERAL("WWW-Authenticate")) != NULL);
+  free_encoded_response(&response);
+
+  release_arena(&arena);
+  free_buffer_pool(&pool);
+
+  // status codes without a prepared response are serialized on demand
+  response = error_response(418, false, NULL);
+  expect_not_null(response);
+  expect_true(response->body->capacity != 0);
+  free_encoded_response(&response);
 }
 
 void test_debug_response() {
@@ -61,15 +96,16 @@ void test_debug_response() {
   str_set(request->resource, "/", 1);
   str_set(request->version, HTTP_VERSION_1_1, strlen(HTTP_VERSION_1_1));
 
-  string *response = debug_response(request);
+  encoded_response_t *response = debug_response(request);
 
-  expect_equal(
-      response, 220,
-      "HTTP/1.1 200 OK\r\nContent-Type: text/html\r\nContent-Length: 125\r\nServer: LLDM/0.1 "
-      "HTTP Server\r\n\r\n<html><head><title>Debug</title></head><body><p>HTTP-Methode: "
-      "GET<br>Ressource: /<br>HTTP-Version: HTTP/1.1</p></body></html>\r\n");
+  expect_equal(response->head, 114,
+               "HTTP/1.1 200 OK\r\nContent-Type: text/html\r\nContent-Length: 125\r\nServer: "
+               "LLDM/0.1 HTTP Server\r\nConnection: close\r\n\r\n");
+  expect_equal(response->body, 125,
+               "<html><head><title>Debug</title></head><body><p>HTTP-Methode: GET<br>Ressource: "
+               "/<br>HTTP-Version: HTTP/1.1</p></body></html>");
 
-  free_str(response);
+  free_encoded_response(&response);
 }
 
 void test_get_http_status_message() {
@@ -92,6 +128,11 @@ void test_get_http_status_message() {
           strlen(STATUS_MESSAGE_NOT_FOUND));
   expect_equal(status_message, strlen(STATUS_MESSAGE_NOT_FOUND), STATUS_MESSAGE_NOT_FOUND);
 
+  str_set(status_message, get_http_status_message(HTTP_REQUEST_HEADER_FIELDS_TOO_LARGE),
+          strlen(STATUS_MESSAGE_REQUEST_HEADER_FIELDS_TOO_LARGE));
+  expect_equal(status_message, strlen(STATUS_MESSAGE_REQUEST_HEADER_FIELDS_TOO_LARGE),
+               STATUS_MESSAGE_REQUEST_HEADER_FIELDS_TOO_LARGE);
+
   str_set(status_message, get_http_status_message(HTTP_INTERNAL_SERVER_ERROR),
           strlen(STATUS_MESSAGE_INTERNAL_SERVER_ERROR));
   expect_equal(status_message, strlen(STATUS_MESSAGE_INTERNAL_SERVER_ERROR),
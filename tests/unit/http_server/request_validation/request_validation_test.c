@@ -48,8 +48,32 @@ void test_supported_method() {
   free_str(method);
 }
 
+void test_request_keep_alive() {
+  test_title("Test request_keep_alive()");
+
+  request_t *request = new_request();
+
+  str_set(request->version, "HTTP/1.1", 8);
+  expect_true(request_keep_alive(request));
+
+  str_set(request->connection, "Close", 5);
+  expect_false(request_keep_alive(request));
+
+  str_set(request->connection, "upgrade,close", 13);
+  expect_false(request_keep_alive(request));
+
+  str_set(request->version, "HTTP/1.0", 8);
+  expect_false(request_keep_alive(request));
+
+  str_set(request->connection, "Keep-Alive", 10);
+  expect_true(request_keep_alive(request));
+
+  free_request(&request);
+}
+
 void run_request_validation_test() {
   test_request_empty();
   test_supported_version();
   test_supported_method();
+  test_request_keep_alive();
 }
\ No newline at end of file
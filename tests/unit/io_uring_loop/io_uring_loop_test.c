@@ -0,0 +1,243 @@
+#define _GNU_SOURCE
+
+#include "io_uring_loop_test.h"
+#include "../../../lib/testing/unit/test-lib.h"
+#include "../../../main.h"
+#include "../../../src/io_uring_loop/io_uring_loop.h"
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+/**
+ * Size of the responses of the test handler (the responses to a few pipelined requests exceed the
+ * socket buffers).
+ */
+#define LARGE_RESPONSE_SIZE (4 * 1024 * 1024)
+
+static char *large_body = NULL;
+static char large_file[] = "/tmp/io_uring_loop_testXXXXXX";
+
+struct loop_options {
+  int sock_fd;
+  int wake_fd;
+  atomic_bool run;
+} typedef loop_options;
+
+/**
+ * @brief Handler that answers every request with a large response and keeps the connection open
+ *
+ * Requests for "/file" are answered with the large file (spliced by the loop), all other requests
+ * with a large body in memory (sent with sendmsg).
+ */
+static encoded_response_t *large_handler(string *request, bool *keep_alive, arena *arena) {
+  (void)keep_alive;
+  (void)arena;
+
+  encoded_response_t *response = new_encoded_response();
+
+  if (strncmp(get_char_str(request), "GET /file ", 10) == 0) {
+    str_set(response->head, "HTTP/1.1 200 OK\r\n\r\n", 19);
+    response->file_fd = open(large_file, O_RDONLY | O_CLOEXEC);
+    response->file_length = LARGE_RESPONSE_SIZE;
+  } else {
+    str_set(response->head, large_body, LARGE_RESPONSE_SIZE);
+  }
+
+  return response;
+}
+
+/**
+ * @brief Run the io_uring loop in a thread
+ *
+ * @param arg The loop_options
+ */
+static void *run_loop(void *arg) {
+  loop_options *options = arg;
+
+  io_uring_loop(options->sock_fd, options->wake_fd, large_handler, &options->run);
+
+  return NULL;
+}
+
+/**
+ * @brief Count the open file descriptors of the process
+ *
+ * @return The number of open file descriptors
+ */
+static size_t count_open_fds() {
+  DIR *dir = opendir("/proc/self/fd");
+  size_t count = 0;
+
+  if (dir == NULL) {
+    return 0;
+  }
+
+  while (readdir(dir) != NULL) {
+    count++;
+  }
+
+  closedir(dir);
+
+  return count;
+}
+
+/**
+ * @brief Check whether the kernel supports io_uring
+ *
+ * @return true if a ring could be set up
+ */
+static bool io_uring_supported() {
+  struct io_uring_params params;
+  memset(&params, 0, sizeof(params));
+
+  int fd = (int)syscall(__NR_io_uring_setup, 1, &params);
+
+  if (fd < 0) {
+    return false;
+  }
+
+  close(fd);
+
+  return true;
+}
+
+/**
+ * @brief Connect a client that sends pipelined requests and never reads the responses
+ *
+ * @param address The address of the server
+ * @param request The request that is sent repeatedly
+ * @return The socket of the client
+ */
+static int connect_stalled_client(struct sockaddr_in *address, const char *request) {
+  int client_fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  int receive_buffer = 4096;
+
+  setsockopt(client_fd, SOL_SOCKET, SO_RCVBUF, &receive_buffer, sizeof(receive_buffer));
+  expect_true(connect(client_fd, (struct sockaddr *)address, sizeof(*address)) == 0);
+
+  for (int i = 0; i < 4; i++) {
+    send(client_fd, request, strlen(request), MSG_NOSIGNAL);
+  }
+
+  return client_fd;
+}
+
+/**
+ * @brief Send data until the server does not receive anything anymore
+ *
+ * @param client_fd The socket of the client
+ * @param limit Maximum number of bytes to send
+ * @return The number of bytes that have been sent
+ */
+static size_t flood(int client_fd, size_t limit) {
+  char data[4096];
+  size_t sent = 0;
+  memset(data, 'a', sizeof(data));
+
+  while (sent < limit) {
+    ssize_t length = send(client_fd, data, sizeof(data), MSG_NOSIGNAL | MSG_DONTWAIT);
+
+    if (length > 0) {
+      sent += length;
+      continue;
+    }
+
+    // the server closed the connection
+    if (errno != EAGAIN && errno != EWOULDBLOCK) {
+      break;
+    }
+
+    // the socket buffers are full and the server does not receive
+    struct pollfd poll_fd = {.fd = client_fd, .events = POLLOUT};
+
+    if (poll(&poll_fd, 1, 500) == 0) {
+      break;
+    }
+  }
+
+  return sent;
+}
+
+void test_io_uring_loop_stalled_client() {
+  test_title("Test io_uring_loop() with pipelining clients that never read");
+
+  if (!io_uring_supported()) {
+    printf("io_uring is not supported by the kernel, skipped\n");
+    return;
+  }
+
+  large_body = calloc(1, LARGE_RESPONSE_SIZE);
+  int file_fd = mkstemp(large_file);
+  expect_true(ftruncate(file_fd, LARGE_RESPONSE_SIZE) == 0);
+  close(file_fd);
+
+  struct sockaddr_in address;
+  socklen_t address_length = sizeof(address);
+  memset(&address, 0, sizeof(address));
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+  // the kernel picks a free port
+  loop_options options = {.run = true};
+  options.sock_fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  options.wake_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+  // accepted sockets inherit the small receive buffer, the backlog in the kernel stays small
+  int receive_buffer = 4096;
+  socklen_t option_length = sizeof(receive_buffer);
+  setsockopt(options.sock_fd, SOL_SOCKET, SO_RCVBUF, &receive_buffer, sizeof(receive_buffer));
+  getsockopt(options.sock_fd, SOL_SOCKET, SO_RCVBUF, &receive_buffer, &option_length);
+  expect_true(bind(options.sock_fd, (struct sockaddr *)&address, sizeof(address)) == 0);
+  expect_true(listen(options.sock_fd, 2) == 0);
+  getsockname(options.sock_fd, (struct sockaddr *)&address, &address_length);
+
+  size_t open_fds = count_open_fds();
+
+  pthread_t thread;
+  pthread_create(&thread, NULL, run_loop, &options);
+
+  int send_client = connect_stalled_client(&address, "GET / HTTP/1.1\r\n\r\n");
+  int splice_client = connect_stalled_client(&address, "GET /file HTTP/1.1\r\n\r\n");
+
+  // the ring, both clients and their connections (the splice uses a pipe and the opened files)
+  sleep(1);
+  expect_true(count_open_fds() > open_fds + 5);
+
+  // a writing connection does not receive, only the socket buffers and the backlog are filled
+  int send_buffer = 4096;
+  setsockopt(send_client, SOL_SOCKET, SO_SNDBUF, &send_buffer, sizeof(send_buffer));
+  getsockopt(send_client, SOL_SOCKET, SO_SNDBUF, &send_buffer, &option_length);
+  size_t limit = IO_URING_MAX_BACKLOG + send_buffer + receive_buffer;
+  expect_true(flood(send_client, 4 * limit) <= limit);
+
+  // the idle connections are closed although their sends never complete
+  sleep(SERVER_KEEP_ALIVE_TIMEOUT + 2);
+  expect_true(count_open_fds() == open_fds + 3);
+
+  close(send_client);
+  close(splice_client);
+
+  options.run = false;
+  uint64_t value = 1;
+  write(options.wake_fd, &value, sizeof(value));
+  pthread_join(thread, NULL);
+
+  close(options.wake_fd);
+  close(options.sock_fd);
+  unlink(large_file);
+  free(large_body);
+}
+
+void run_io_uring_loop_test() {
+  test_io_uring_loop_stalled_client();
+}
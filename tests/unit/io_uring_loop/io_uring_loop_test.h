@@ -0,0 +1,7 @@
+#ifndef IO_URING_LOOP_TEST_H
+#define IO_URING_LOOP_TEST_H
+
+/// @brief Runs the tests
+void run_io_uring_loop_test();
+
+#endif
@@ -1,10 +1,15 @@
 #include "../../lib/testing/unit/test-lib.h"
+#include "arena/arena_test.h"
+#include "buffer_pool/buffer_pool_test.h"
+#include "file_lib/file_lib_test.h"
 #include "http-lib/http-lib_test.h"
+#include "http_connection/http_connection_test.h"
 #include "http_models/http_models_test.h"
 #include "http_parser/http_parser_test.h"
 #include "http_router/http_router_test.h"
 #include "http_server/http_server_test.h"
 #include "http_server/request_validation/request_validation_test.h"
+#include "io_uring_loop/io_uring_loop_test.h"
 
 /**
  * @brief Run all tests
@@ -13,11 +18,16 @@
  */
 int main() {
   run_httplib_test();
+  run_buffer_pool_test();
+  run_arena_test();
+  run_file_lib_test();
   run_http_models_test();
   run_http_parser_test();
   run_http_router_test();
   run_http_server_test();
   run_request_validation_test();
+  run_http_connection_test();
+  run_io_uring_loop_test();
 
   return test_summary();
 }
\ No newline at end of file